@@ -4,8 +4,51 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <memory>
 #include <cstdint>
+#include <cstring>
+#include <cctype>
 #include <exception>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <sys/stat.h>
+
+#if !defined(EASYVDF_NO_SIMD)
+    #if defined(__AVX2__)
+        #define EASYVDF_USE_AVX2
+    #endif
+    #if defined(__SSSE3__) || defined(__AVX__)
+        #define EASYVDF_USE_SSSE3
+    #endif
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define EASYVDF_USE_SSE2
+    #endif
+    #if defined(__PCLMUL__) && (defined(__x86_64__) || defined(_M_X64))
+        #define EASYVDF_USE_PCLMUL
+    #endif
+#endif
+
+// Minimum size of the chunks of a text VDF parsed on several threads.
+#if !defined(EASYVDF_PARALLEL_MIN_CHUNK_SIZE)
+    #define EASYVDF_PARALLEL_MIN_CHUNK_SIZE (1024 * 1024)
+#endif
+
+#if defined(EASYVDF_USE_AVX2) || defined(EASYVDF_USE_PCLMUL)
+    #include <immintrin.h>
+#elif defined(EASYVDF_USE_SSSE3)
+    #include <tmmintrin.h>
+#elif defined(EASYVDF_USE_SSE2)
+    #include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(EASYVDF_USE_AVX2) || defined(EASYVDF_USE_SSE2))
+    #include <intrin.h>
+#endif
 
 namespace EasyVDF {
 
@@ -28,6 +71,85 @@ enum class ObjectType : int8_t
 };
 
 class ValveDataObject;
+class ValveDataObjectBuilder;
+class ValveDataResolver;
+class ValveDataIncludeCache;
+
+struct ParseOptions
+{
+    // Size of the blocks read from a stream.
+    size_t chunk_size = 10 * 1024;
+    // Maximum number of nested objects, root included.
+    uint32_t max_depth = 512;
+    // Decode the escape sequences (\n, \t, \", ...) of text strings, or keep them as is.
+    bool escape_sequences = true;
+    // Threads used to parse a VDF that is in memory into a ValveDataObject, 0 for one per hardware thread.
+    uint32_t threads = 1;
+    // Reject the inputs that are not valid UTF-8 with a ParserException.
+    bool validate_utf8 = false;
+    // Finds the files of the #base and #include directives of text VDF, the directives are only recognized when set.
+    // Only used when parsing into a ValveDataObject.
+    ValveDataResolver* resolver = nullptr;
+    // Included files that were already parsed, can be shared by any number of parses.
+    ValveDataIncludeCache* include_cache = nullptr;
+    // Text values that are numbers become Int32, Int64, UInt64 or Float values, when they serialize back to the same text.
+    // Not applied by ValveDataCursor.
+    bool infer_types = false;
+    // Check the CRC of binary VDF with a VBKV header, a mismatch throws a ParserException once the items are reported.
+    // The CRC is updated with the bytes as they are decoded. Checked by ParseObject, ParseWithHandler, ValveDataView
+    // and ValveDataPushParser, a checked binary VDF is parsed on a single thread.
+    bool verify_crc = false;
+    // Level of the items a binary VDF parsed on several threads is split at: 1 for the items of the root, 2 for their children...
+    // The objects above it are walked by a single thread, a level with many items spreads the work best.
+    uint32_t binary_split_depth = 1;
+    // Symbols (without the $) of the [$SYMBOL] conditions of text VDF, the conditions are only evaluated when set.
+    // The items whose condition is false are skipped. Evaluated by ParseObject, ParseWithHandler and ValveDataView.
+    std::vector<std::string> const* defines = nullptr;
+};
+
+class ParserException : public std::exception
+{
+    std::string _Msg;
+public:
+    ParserException(std::string msg) :
+        _Msg(std::move(msg))
+    {}
+
+    virtual char const* what() const noexcept
+    {
+        return _Msg.c_str();
+    }
+};
+
+/// <summary>
+/// Error found by a parse that collects its errors and goes on, instead of throwing a ParserException.
+/// </summary>
+struct ParseDiagnostic
+{
+    enum class Kind : uint8_t
+    {
+        // Not a VDF, or an error of a binary VDF: the parse stopped there.
+        InvalidInput,
+        InvalidUtf8,
+        ExpectedKey,
+        ExpectedValue,
+        ExpectedObjectStart,
+        UnterminatedString,
+        UnclosedObject,
+        MaxDepthExceeded,
+        InvalidCondition,
+        InvalidDirective,
+        TrailingData,
+    };
+
+    Kind kind;
+    // Both start at 1, the column counts bytes.
+    uint32_t line;
+    uint32_t column;
+    // Offset of the error in the input.
+    size_t offset;
+    std::string message;
+};
 
 template<typename T>
 class ValveDataObjectRefWrapper;
@@ -49,1619 +171,7077 @@ struct color_t
     uint32_t value;
 };
 
-namespace Details {
-
-static inline bool is_cr(char c)
+// Text of a WideString item in UTF-8, binary VDF stores it in UTF-16.
+struct wide_string_t
 {
-    return c == '\r';
-}
+    std::string value;
+};
 
-static inline bool is_cr(wchar_t c)
+// Bytes of a Binary item.
+struct binary_t
 {
-    return c == L'\r';
-}
+    std::string value;
+};
 
-static inline bool is_lf(char c)
+/// <summary>
+/// Non owning reference to a range of characters, the characters must outlive the view.
+/// </summary>
+class StringView
 {
-    return c == '\n';
-}
+    const char* _Data;
+    size_t _Size;
 
-static inline bool is_lf(wchar_t c)
-{
-    return c == L'\n';
-}
+public:
+    StringView() :
+        _Data(""),
+        _Size(0)
+    {}
 
-template<typename CharT, typename Traits, typename Allocator>
-static std::basic_istream<CharT, Traits>& getline(std::basic_istream<CharT, Traits>& is, std::basic_string<CharT, Traits, Allocator>& buffer)
-{
-    CharT c;
+    StringView(const char* data, size_t size) :
+        _Data(data),
+        _Size(size)
+    {}
 
-    buffer.clear();
-    while(is.get(c))
+    StringView(const char* str) :
+        _Data(str),
+        _Size(strlen(str))
+    {}
+
+    StringView(std::string const& str) :
+        _Data(str.data()),
+        _Size(str.length())
+    {}
+
+    inline const char* data() const
     {
-        buffer.push_back(c);
-        
-        if (is_cr(c))
-        {// MacOS EOL.
-            // Nope, Windows EOL.
-            c = is.peek();
-            if (is_lf(c))
-                buffer.push_back(is.get());
-            
-            break;
-        }
-        else if(is_lf(c))
-        {// Linux EOL.
-            break;
-        }
+        return _Data;
     }
-    
-    return is;
-}
 
-inline void SkipSpaces(const char*& s, const char*& e)
-{
-    while (s != e)
+    inline size_t size() const
     {
-        char c = *s;
-        if (c != ' ' && c != '\t')
-            break;
-
-        ++s;
+        return _Size;
     }
-    while ((e-1) != s)
-    {
-        char c = *(e-1);
-        if (c != '\n' && c != '\r')
-            break;
 
-        --e;
+    inline size_t length() const
+    {
+        return _Size;
     }
-}
-
-inline void ReadBinaryBytes(const char*& b, const char* e, std::string& buffer, size_t max_size)
-{
-    size_t left_count = (b + max_size - buffer.length()) > e ? e - b : max_size - buffer.length();
-    buffer.insert(buffer.end(), b, b + left_count);
-    b += left_count;
-}
 
-/// <summary>
-/// Returns  0 when string is read to end (null char)
-/// Returns -1 when string was partially read
-/// Returns -2 when invalid utf8 codepoint was found
-/// </summary>
-/// <param name="b"></param>
-/// <param name="e"></param>
-/// <param name="str"></param>
-/// <returns></returns>
-inline int ParseBinaryString(const char*& b, const char* e, std::string& str)
-{
-    const char* string_start = b;
-    while (b != e)
+    inline bool empty() const
     {
-        char c = *b++;
-        if (c < 0x80u)
-        {
-            if (c == '\0')
-            {
-                str.insert(str.end(), string_start, b - 1);
-                return 0;
-            }
-        }
-        else if ((c >> 5) == 0x6)
-        {// 2 bytes utf8
-            if (b == e)
-                return -2;
-
-            ++b;
-        }
-        else if ((c >> 4) == 0xe)
-        {// 3 bytes utf8
-            if (b == (e - 1))
-                return -2;
-
-            b += 2;
-        }
-        else if ((c >> 3) == 0x1e)
-        {// 4 bytes utf8
-            if (b == (e - 2))
-                return -2;
-
-            b += 3;
-        }
+        return _Size == 0;
     }
 
-    str.insert(str.end(), string_start, b - 1);
-    return -1;
-}
+    inline const char* begin() const
+    {
+        return _Data;
+    }
 
-inline int ParseString(const char*& b, const char* e, std::string& str)
-{
-    bool has_escape = false;
-    const char* string_start = nullptr;
-    while (b != e)
+    inline const char* end() const
     {
-        char c = *b++;
-        if (has_escape)
-        {
-            has_escape = false;
-        }
-        else if (c == '\\')
-        {
-            has_escape = true;
-        }
-        else if (c == '"')
-        {
-            string_start = b;
-            break;
-        }
+        return _Data + _Size;
     }
-    while (b != e)
+
+    inline char operator[](size_t index) const
     {
-        unsigned char c = *b++;
-        if (c < 0x80u)
-        {
-            if (c == '\\')
-            {
-                has_escape = true;
-                continue;
-            }
-            if (has_escape)
-            {
-                has_escape = false;
-                continue;
-            }
-            if (c == '"')
-            {
-                str.assign(string_start, b - 1);
-                return 0;
-            }
-        }
-        else if ((c >> 5) == 0x6)
-        {// 2 bytes utf8
-            if (b == e)
-                return -3;
+        return _Data[index];
+    }
 
-            ++b;
-        }
-        else if ((c >> 4) == 0xe)
-        {// 3 bytes utf8
-            if (b == (e - 1))
-                return -3;
+    inline std::string str() const
+    {
+        return std::string(_Data, _Size);
+    }
 
-            b += 2;
-        }
-        else if ((c >> 3) == 0x1e)
-        {// 4 bytes utf8
-            if (b == (e - 2))
-                return -3;
+    inline int compare(StringView other) const
+    {
+        int result = memcmp(_Data, other._Data, _Size < other._Size ? _Size : other._Size);
+        if (result != 0)
+            return result;
 
-            b += 3;
-        }
+        return _Size < other._Size ? -1 : (_Size > other._Size ? 1 : 0);
     }
-    if (string_start == nullptr)
-        return -1;
 
-    return -2;
-}
+    friend inline bool operator==(StringView v1, StringView v2)
+    {
+        return v1._Size == v2._Size && memcmp(v1._Data, v2._Data, v1._Size) == 0;
+    }
 
-}
+    friend inline bool operator!=(StringView v1, StringView v2)
+    {
+        return !(v1 == v2);
+    }
 
-class ParserException : public std::exception
-{
-    std::string _Msg;
-public:
-    ParserException(std::string msg) :
-        _Msg(std::move(msg))
-    {}
+    friend inline bool operator<(StringView v1, StringView v2)
+    {
+        return v1.compare(v2) < 0;
+    }
 
-    virtual char const* what() const noexcept
+    friend inline std::ostream& operator<<(std::ostream& os, StringView v)
     {
-        return _Msg.c_str();
+        return os.write(v._Data, v._Size);
     }
 };
 
-class SerializeException : public std::exception
+/// <summary>
+/// Typed value of an item, as reported to the parse handlers. Strings are only valid during the call.
+/// </summary>
+class ValveDataValue
 {
-    const char* _Msg;
+    ObjectType _Type;
+    StringView _String;
+    union
+    {
+        int32_t _Int32;
+        float _Float;
+        pointer_t _Pointer;
+        color_t _Color;
+        int64_t _Int64;
+        uint64_t _UInt64;
+    } _U;
+
 public:
-    SerializeException(const char* msg):
-        _Msg(msg)
-    {}
+    ValveDataValue() :
+        _Type(ObjectType::None)
+    {
+        _U._UInt64 = 0;
+    }
 
-    virtual char const* what() const noexcept
+    ValveDataValue(StringView value) :
+        _Type(ObjectType::String),
+        _String(value)
     {
-        return _Msg;
+        _U._UInt64 = 0;
     }
-};
 
-template<typename T>
-class ValveDataObjectRefWrapper
-{
-    T* _Obj;
+    // String, WideString (in UTF-8) or Binary value.
+    ValveDataValue(ObjectType type, StringView value) :
+        _Type(type),
+        _String(value)
+    {
+        _U._UInt64 = 0;
+    }
 
-public:
-    ValveDataObjectRefWrapper(T*);
+    ValveDataValue(int32_t value) :
+        _Type(ObjectType::Int32)
+    {
+        _U._UInt64 = 0;
+        _U._Int32 = value;
+    }
 
-    ValveDataObjectRefWrapper(ValveDataObjectRefWrapper<T> const& o);
+    ValveDataValue(float value) :
+        _Type(ObjectType::Float)
+    {
+        _U._UInt64 = 0;
+        _U._Float = value;
+    }
 
-    inline std::string const& Name() const;
+    ValveDataValue(pointer_t value) :
+        _Type(ObjectType::Pointer)
+    {
+        _U._UInt64 = 0;
+        _U._Pointer = value;
+    }
 
-    inline ObjectType Type() const;
+    ValveDataValue(color_t value) :
+        _Type(ObjectType::Color)
+    {
+        _U._UInt64 = 0;
+        _U._Color = value;
+    }
 
-    inline bool Empty() const;
+    ValveDataValue(int64_t value) :
+        _Type(ObjectType::Int64)
+    {
+        _U._Int64 = value;
+    }
 
-    inline std::string& String();
+    ValveDataValue(uint64_t value) :
+        _Type(ObjectType::UInt64)
+    {
+        _U._UInt64 = value;
+    }
 
-    inline std::string const& String() const;
+    inline ObjectType Type() const
+    {
+        return _Type;
+    }
 
-    inline ValveCollection& Collection();
+    inline StringView String() const
+    {
+        if (_Type != ObjectType::String)
+            throw std::invalid_argument("Attempted to read a String from a non String type.");
 
-    inline ValveCollection const& Collection() const;
+        return _String;
+    }
 
-    inline bool operator==(std::nullptr_t);
+    inline StringView WideString() const
+    {
+        if (_Type != ObjectType::WideString)
+            throw std::invalid_argument("Attempted to read a WideString from a non WideString type.");
 
-    inline ValveDataObjectRefWrapper& operator=(ValveDataObjectRefWrapper const&);
+        return _String;
+    }
 
-    inline ValveDataObjectRefWrapper& operator=(ValveDataObjectRefWrapper &&);
+    inline StringView Binary() const
+    {
+        if (_Type != ObjectType::Binary)
+            throw std::invalid_argument("Attempted to read a Binary from a non Binary type.");
 
-    inline ValveDataObjectRefWrapper& operator=(T const&);
+        return _String;
+    }
 
-    inline ValveDataObjectRefWrapper& operator=(T&&);
+    inline int32_t Int32() const
+    {
+        if (_Type != ObjectType::Int32)
+            throw std::invalid_argument("Attempted to get an Int32 from non Int32 type.");
 
-    inline ValveDataObjectRefWrapper& operator=(std::nullptr_t);
+        return _U._Int32;
+    }
 
-    inline ValveDataObjectRefWrapper& operator=(std::string const& value);
+    inline float Float() const
+    {
+        if (_Type != ObjectType::Float)
+            throw std::invalid_argument("Attempted to get a Float from non Float type.");
 
-    inline ValveDataObjectRefWrapper& operator=(std::string&& value);
+        return _U._Float;
+    }
 
-    inline ValveDataObjectRefWrapper& operator=(int32_t value);
+    inline pointer_t Pointer() const
+    {
+        if (_Type != ObjectType::Pointer)
+            throw std::invalid_argument("Attempted to get a Pointer from non Pointer type.");
 
-    inline ValveDataObjectRefWrapper& operator=(pointer_t value);
+        return _U._Pointer;
+    }
 
-    inline ValveDataObjectRefWrapper& operator=(color_t value);
+    inline color_t Color() const
+    {
+        if (_Type != ObjectType::Color)
+            throw std::invalid_argument("Attempted to get a Color from non Color type.");
 
-    inline ValveDataObjectRefWrapper& operator=(float value);
+        return _U._Color;
+    }
 
-    inline ValveDataObjectRefWrapper& operator=(int64_t value);
+    inline int64_t Int64() const
+    {
+        if (_Type != ObjectType::Int64)
+            throw std::invalid_argument("Attempted to get an Int64 from non Int64 type.");
 
-    inline ValveDataObjectRefWrapper& operator=(uint64_t value);
+        return _U._Int64;
+    }
 
-    inline int32_t Int32() const;
+    inline uint64_t UInt64() const
+    {
+        if (_Type != ObjectType::UInt64)
+            throw std::invalid_argument("Attempted to get an UInt64 from non UInt64 type.");
 
-    inline float Float() const;
+        return _U._UInt64;
+    }
+};
 
-    inline pointer_t Pointer() const;
+class ValveDataView;
 
-    inline color_t Color() const;
+namespace Details {
 
-    inline int64_t Int64() const;
+class ViewBuilder;
 
-    inline uint64_t UInt64() const;
+static inline bool is_cr(char c)
+{
+    return c == '\r';
+}
 
-    inline ValveCollectionRef operator[](const char* key);
+static inline bool is_cr(wchar_t c)
+{
+    return c == L'\r';
+}
 
-    inline ValveCollectionRef operator[](std::string const& key);
+static inline bool is_lf(char c)
+{
+    return c == '\n';
+}
 
-    inline ValveCollectionConstRef operator[](const char* key) const;
+static inline bool is_lf(wchar_t c)
+{
+    return c == L'\n';
+}
 
-    inline ValveCollectionConstRef operator[](std::string const& key) const;
+static inline uint32_t CountTrailingZeros(uint32_t v)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, v);
+    return index;
+#else
+    return __builtin_ctz(v);
+#endif
+}
 
-    inline std::string SerializeAsText() const;
+static inline uint32_t CountTrailingZeros64(uint64_t v)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, v);
+    return index;
+#elif defined(_MSC_VER)
+    return (uint32_t)v != 0 ? CountTrailingZeros((uint32_t)v) : 32 + CountTrailingZeros((uint32_t)(v >> 32));
+#else
+    return __builtin_ctzll(v);
+#endif
+}
 
-    inline std::string SerializeAsBinary(int version = 0) const;
+static inline uint32_t PopCount64(uint64_t v)
+{
+#if defined(_MSC_VER)
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (uint32_t)((v * 0x0101010101010101ull) >> 56);
+#else
+    return (uint32_t)__builtin_popcountll(v);
+#endif
+}
 
-    inline void SerializeAsText(std::ostream& os) const;
+// Each bit of the result is the xor of all the bits below and including it.
+static inline uint64_t PrefixXor(uint64_t v)
+{
+#if defined(EASYVDF_USE_PCLMUL)
+    return (uint64_t)_mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, (int64_t)v), _mm_set1_epi8((char)0xff), 0));
+#else
+    v ^= v << 1;
+    v ^= v << 2;
+    v ^= v << 4;
+    v ^= v << 8;
+    v ^= v << 16;
+    v ^= v << 32;
+    return v;
+#endif
+}
 
-    inline void SerializeAsBinary(std::ostream& os, int version = 0) const;
+enum class BinaryNodeType : int8_t
+{
+    Object         = 0,
+    String         = 1,
+    Int32          = 2,
+    Float          = 3,
+    Pointer        = 4,
+    WideString     = 5,
+    Color          = 6,
+    UInt64         = 7,
+    ObjectEnd      = 8,
+    Binary         = 9,
+    Int64          = 10,
+    AlternativeEnd = 11,
 };
 
-class ValveDataObject
+class StreamChunkReader
 {
-private:
-    enum class BinaryNodeType : int8_t
-    {
-        Object         = 0,
-        String         = 1,
-        Int32          = 2,
-        Float          = 3,
-        Pointer        = 4,
-        WideString     = 5,
-        Color          = 6,
-        UInt64         = 7,
-        ObjectEnd      = 8,
-        Binary         = 9,
-        Int64          = 10,
-        AlternativeEnd = 11,
-    };
+    std::istream& _Is;
+    std::string& _Buffer;
 
-    class Data_t
-    {
-        friend class ValveDataObject;
+public:
+    StreamChunkReader(std::istream& is, std::string& buffer) :
+        _Is(is),
+        _Buffer(buffer)
+    {}
 
-        std::string _Name;
-        size_t _NameHash;
-        union
-        {
-            std::string* _String;
-            ValveCollection* _Collection;
-            int32_t _Int32;
-            float _Float;
-            pointer_t _Pointer;
-            color_t _Color;
-            int64_t _Int64;
-            uint64_t _UInt64;
-        } _U;
-        ObjectType _Type;
+    inline bool Read(const char*& buffer_start, const char*& buffer_end)
+    {
+        _Is.read(&_Buffer[0], _Buffer.length());
+        buffer_start = _Buffer.data();
+        buffer_end = buffer_start + _Is.gcount();
+        return buffer_start != buffer_end;
+    }
+};
 
-    public:
-        Data_t() :
-            _Name(),
-            _NameHash(std::hash<std::string>()(_Name)),
-            _Type(ObjectType::None)
-        {}
-    };
+inline void ReadBinaryBytes(const char*& b, const char* e, std::string& buffer, size_t max_size)
+{
+    size_t left_count = (size_t)(e - b) < max_size - buffer.length() ? e - b : max_size - buffer.length();
+    buffer.insert(buffer.end(), b, b + left_count);
+    b += left_count;
+}
 
-    Data_t *_Obj;
+/// <summary>
+/// Appends the bytes of a null terminated string to str, up to its terminator or the end of the chunk.
+/// Returns  0 when string is read to end (null char)
+/// Returns -1 when string was partially read
+/// </summary>
+/// <param name="b"></param>
+/// <param name="e"></param>
+/// <param name="str"></param>
+/// <returns></returns>
+inline int ParseBinaryString(const char*& b, const char* e, std::string& str)
+{
+    // UTF-8 continuation bytes are never null, the end is the first null byte.
+    const char* string_end = static_cast<const char*>(memchr(b, '\0', e - b));
+    if (string_end == nullptr)
+    {
+        str.append(b, e);
+        b = e;
+        return -1;
+    }
 
-    void _ResetValue();
+    str.append(b, string_end);
+    b = string_end + 1;
+    return 0;
+}
 
-    static void _ParseTextObject(std::istream& is, std::string& name, std::string& buffer, uint32_t& line_num, ValveDataObject& o);
+/// <summary>
+/// Finds the terminator of a null terminated UTF-16 string: the first null code unit of [b, e).
+/// Returns nullptr when there is none.
+/// </summary>
+inline const char* FindWideStringEnd(const char* b, const char* e)
+{
+    const char* p = b;
+#if defined(EASYVDF_USE_SSE2)
+    for (; e - p >= 16; p += 16)
+    {
+        __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(units, _mm_setzero_si128()));
+        if (mask != 0)
+            return p + CountTrailingZeros(mask);
+    }
+#endif
+    for (; e - p >= 2; p += 2)
+    {
+        if (p[0] == '\0' && p[1] == '\0')
+            return p;
+    }
 
-    static void _ParseBinaryObject(std::istream& is, std::string& name, BinaryNodeType object_end, std::string& buffer, const char*& buffer_start, const char*& buffer_end, ValveDataObject& o);
+    return nullptr;
+}
 
-    void _SerializeAsText(std::ostream& os, size_t depth) const;
+/// <summary>
+/// Appends the code units of a null terminated UTF-16 string to str, up to its terminator or the end of the chunk.
+/// A code unit cut by the end of the chunk is completed by the next one.
+/// Returns  0 when string is read to end (null code unit)
+/// Returns -1 when string was partially read
+/// </summary>
+inline int ParseBinaryWideString(const char*& b, const char* e, std::string& str)
+{
+    if (str.length() % 2 != 0)
+    {// Second byte of the last code unit
+        str.push_back(*b++);
+        if (str[str.length() - 2] == '\0' && str[str.length() - 1] == '\0')
+        {
+            str.resize(str.length() - 2);
+            return 0;
+        }
+    }
 
-    void _SerializeAsBinary(std::ostream& os, BinaryNodeType object_end, uint32_t crc) const;
+    const char* string_end = FindWideStringEnd(b, e);
+    if (string_end == nullptr)
+    {
+        str.append(b, e);
+        b = e;
+        return -1;
+    }
 
-public:
-    ValveDataObject();
+    str.append(b, string_end);
+    b = string_end + 2;
+    return 0;
+}
 
-    ValveDataObject(ValveDataObject const& other);
+inline char UnescapeChar(char c)
+{
+    switch (c)
+    {
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'v': return '\v';
+        case 'b': return '\b';
+        case 'f': return '\f';
+        case 'a': return '\a';
+        case '\\':
+        case '"' :
+        case '\'':
+        case '?' : return c;
+    }
 
-    ValveDataObject(ValveDataObject&& other) noexcept;
-    
-    ValveDataObject(std::string const& key);
-    
-    ValveDataObject(std::string const& key, ValveDataObject const& other);
+    return '\0';
+}
 
-    ValveDataObject(std::string const& key, ValveDataObject&& other) noexcept;
+/// <summary>
+/// Decodes the escape sequences of [b, e) into str. Unknown sequences are kept as is.
+/// </summary>
+inline void UnescapeString(const char* b, const char* e, std::string& str)
+{
+    str.clear();
+    const char* escape;
+    while ((escape = static_cast<const char*>(memchr(b, '\\', e - b))) != nullptr)
+    {
+        str.append(b, escape);
+        if ((escape + 1) == e)
+        {
+            b = escape;
+            break;
+        }
 
-    ValveDataObject(std::string const& key, std::string const& value);
+        char c = UnescapeChar(escape[1]);
+        if (c != '\0')
+        {
+            str.push_back(c);
+        }
+        else
+        {
+            str.append(escape, escape + 2);
+        }
+        b = escape + 2;
+    }
+    str.append(b, e);
+}
 
-    ValveDataObject(std::string const& key, std::string&& value);
+/// <summary>
+/// Writes str as a quoted text string, escaping the characters the text parser would decode.
+/// </summary>
+inline void WriteEscapedString(std::ostream& os, std::string const& str)
+{
+    const char* b = str.data();
+    const char* e = b + str.length();
+    const char* p = b;
 
-    ValveDataObject(std::string const& key, int32_t value);
+    os.put('"');
+    for (; p != e; ++p)
+    {
+        char escaped;
+        switch (*p)
+        {
+            case '"' : escaped = '"'; break;
+            case '\\': escaped = '\\'; break;
+            case '\n': escaped = 'n'; break;
+            case '\t': escaped = 't'; break;
+            case '\r': escaped = 'r'; break;
+            default: continue;
+        }
 
-    ValveDataObject(std::string const& key, float value);
+        os.write(b, p - b);
+        os.put('\\');
+        os.put(escaped);
+        b = p + 1;
+    }
+    os.write(b, p - b);
+    os.put('"');
+}
 
-    ValveDataObject(std::string const& key, pointer_t value);
+/// <summary>
+/// Writes str as a quoted text string as is, for the text parsed without decoding the escape sequences.
+/// Returns false without writing anything when a quote or a final backslash of str would end the string elsewhere.
+/// </summary>
+inline bool WriteRawString(std::ostream& os, std::string const& str)
+{
+    // Like the tokenizer, a backslash hides the character after it.
+    bool escaped = false;
+    for (char c : str)
+    {
+        if (c == '"' && !escaped)
+            return false;
 
-    ValveDataObject(std::string const& key, color_t value);
+        escaped = c == '\\' && !escaped;
+    }
+    if (escaped)
+        return false;
 
-    ValveDataObject(std::string const& key, int64_t value);
+    os.put('"');
+    os.write(str.data(), str.length());
+    os.put('"');
+    return true;
+}
 
-    ValveDataObject(std::string const& key, uint64_t value);
+/// <summary>
+/// Writes the bytes as lowercase hexadecimal digits.
+/// </summary>
+inline void WriteHexString(std::ostream& os, std::string const& bytes)
+{
+    static const char digits[] = "0123456789abcdef";
 
-    ~ValveDataObject();
+    std::string hex(bytes.length() * 2, '\0');
+    for (size_t i = 0; i < bytes.length(); ++i)
+    {
+        hex[i * 2] = digits[(uint8_t)bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[(uint8_t)bytes[i] & 0x0f];
+    }
+    os.write(hex.data(), hex.length());
+}
 
-    inline void Name(std::string const& value);
+/// <summary>
+/// Character classes of a 64 bytes text block, one bit per byte.
+/// </summary>
+struct TextBlock
+{
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t open_brace;
+    uint64_t close_brace;
+    uint64_t whitespace;
+    uint64_t cr;
+    uint64_t lf;
+};
 
-    inline void Name(std::string && value);
+inline void ClassifyTextBlock(const char* p, TextBlock& block)
+{
+#if defined(EASYVDF_USE_AVX2)
+    const __m256i quote       = _mm256_set1_epi8('"');
+    const __m256i backslash   = _mm256_set1_epi8('\\');
+    const __m256i open_brace  = _mm256_set1_epi8('{');
+    const __m256i close_brace = _mm256_set1_epi8('}');
+    const __m256i space       = _mm256_set1_epi8(' ');
+    const __m256i tab         = _mm256_set1_epi8('\t');
+    const __m256i cr          = _mm256_set1_epi8('\r');
+    const __m256i lf          = _mm256_set1_epi8('\n');
+
+    block = TextBlock{};
+    for (int i = 0; i < 64; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i v_cr = _mm256_cmpeq_epi8(v, cr);
+        __m256i v_lf = _mm256_cmpeq_epi8(v, lf);
+        __m256i v_ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)), _mm256_or_si256(v_cr, v_lf));
+
+        block.quote       |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << i;
+        block.backslash   |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)) << i;
+        block.open_brace  |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, open_brace)) << i;
+        block.close_brace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, close_brace)) << i;
+        block.whitespace  |= (uint64_t)(uint32_t)_mm256_movemask_epi8(v_ws) << i;
+        block.cr          |= (uint64_t)(uint32_t)_mm256_movemask_epi8(v_cr) << i;
+        block.lf          |= (uint64_t)(uint32_t)_mm256_movemask_epi8(v_lf) << i;
+    }
+#elif defined(EASYVDF_USE_SSE2)
+    const __m128i quote       = _mm_set1_epi8('"');
+    const __m128i backslash   = _mm_set1_epi8('\\');
+    const __m128i open_brace  = _mm_set1_epi8('{');
+    const __m128i close_brace = _mm_set1_epi8('}');
+    const __m128i space       = _mm_set1_epi8(' ');
+    const __m128i tab         = _mm_set1_epi8('\t');
+    const __m128i cr          = _mm_set1_epi8('\r');
+    const __m128i lf          = _mm_set1_epi8('\n');
+
+    block = TextBlock{};
+    for (int i = 0; i < 64; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i v_cr = _mm_cmpeq_epi8(v, cr);
+        __m128i v_lf = _mm_cmpeq_epi8(v, lf);
+        __m128i v_ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)), _mm_or_si128(v_cr, v_lf));
+
+        block.quote       |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << i;
+        block.backslash   |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << i;
+        block.open_brace  |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, open_brace)) << i;
+        block.close_brace |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, close_brace)) << i;
+        block.whitespace  |= (uint64_t)(uint32_t)_mm_movemask_epi8(v_ws) << i;
+        block.cr          |= (uint64_t)(uint32_t)_mm_movemask_epi8(v_cr) << i;
+        block.lf          |= (uint64_t)(uint32_t)_mm_movemask_epi8(v_lf) << i;
+    }
+#else
+    block = TextBlock{};
+    for (int i = 0; i < 64; ++i)
+    {
+        uint64_t bit = 1ull << i;
+        switch (p[i])
+        {
+            case '"' : block.quote       |= bit; break;
+            case '\\': block.backslash   |= bit; break;
+            case '{' : block.open_brace  |= bit; break;
+            case '}' : block.close_brace |= bit; break;
+            case ' ' :
+            case '\t': block.whitespace  |= bit; break;
+            case '\r': block.whitespace  |= bit; block.cr |= bit; break;
+            case '\n': block.whitespace  |= bit; block.lf |= bit; break;
+        }
+    }
+#endif
+}
 
-    inline std::string const& Name() const;
+/// <summary>
+/// State of the UTF-8 sequence being checked: continuation bytes left, and the range of the next one.
+/// </summary>
+struct Utf8State
+{
+    uint8_t remaining = 0;
+    uint8_t low = 0x80;
+    uint8_t high = 0xbf;
+};
 
-    inline ObjectType Type() const;
+/// <summary>
+/// Checks the bytes against the well-formed UTF-8 sequences (RFC 3629), starting from state.
+/// Returns the offset of the first invalid byte, or size when there is none.
+/// </summary>
+inline size_t CheckUtf8(const char* data, size_t size, Utf8State& state)
+{
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    size_t i = 0;
 
-    inline bool Empty() const;
+    while (i != size)
+    {
+        if (state.remaining == 0)
+        {// ASCII fast path
+            uint64_t word;
+            while (size - i >= 8 && (memcpy(&word, p + i, 8), (word & 0x8080808080808080ull) == 0))
+                i += 8;
 
-    std::string& String();
+            if (i == size)
+                break;
 
-    std::string const& String() const;
+            unsigned char c = p[i];
+            if (c < 0x80)
+            {
+                ++i;
+                continue;
+            }
 
-    ValveCollection& Collection();
+            state.low = 0x80;
+            state.high = 0xbf;
+            if (c >= 0xc2 && c <= 0xdf)
+            {
+                state.remaining = 1;
+            }
+            else if (c >= 0xe0 && c <= 0xef)
+            {
+                state.remaining = 2;
+                if (c == 0xe0)
+                    state.low = 0xa0;
+                else if (c == 0xed)
+                    state.high = 0x9f;
+            }
+            else if (c >= 0xf0 && c <= 0xf4)
+            {
+                state.remaining = 3;
+                if (c == 0xf0)
+                    state.low = 0x90;
+                else if (c == 0xf4)
+                    state.high = 0x8f;
+            }
+            else
+            {
+                return i;
+            }
+        }
+        else
+        {
+            unsigned char c = p[i];
+            if (c < state.low || c > state.high)
+                return i;
 
-    ValveCollection const& Collection() const;
+            --state.remaining;
+            state.low = 0x80;
+            state.high = 0xbf;
+        }
+        ++i;
+    }
 
-    inline bool operator==(std::nullptr_t);
+    return size;
+}
 
-    ValveDataObject& operator=(ValveDataObject const& other);
+/// <summary>
+/// UTF-8 validation of consecutive chunks of input, using the lookup tables algorithm of Keiser and Lemire when SIMD is available.
+/// ASCII chunks are only checked against the end of the previous one.
+/// </summary>
+class Utf8Validator
+{
+#if defined(EASYVDF_USE_SSSE3)
+    // Last 16 bytes checked, and their sequences that are not finished.
+    __m128i _Previous;
+    __m128i _Incomplete;
 
-    ValveDataObject& operator=(ValveDataObject&& other) noexcept;
+    static inline __m128i _HighNibbles(__m128i v)
+    {
+        return _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f));
+    }
 
-    ValveDataObject& operator=(std::nullptr_t);
+    inline __m128i _Check(__m128i input)
+    {
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            __m128i error = _Incomplete;
+            _Previous = input;
+            _Incomplete = _mm_setzero_si128();
+            return error;
+        }
 
-    ValveDataObject& operator=(std::string const& value);
+        const char too_short  = 1 << 0;
+        const char too_long   = 1 << 1;
+        const char overlong_3 = 1 << 2;
+        const char too_large  = 1 << 3;
+        const char surrogate  = 1 << 4;
+        const char overlong_2 = 1 << 5;
+        const char too_large_1000 = 1 << 6;
+        const char overlong_4 = 1 << 6;
+        const char two_conts  = (char)(1 << 7);
+        const char carry      = too_short | too_long | two_conts;
+
+        __m128i prev1 = _mm_alignr_epi8(input, _Previous, 15);
+        __m128i byte_1_high = _mm_shuffle_epi8(_mm_setr_epi8(
+            // 0___ ASCII
+            too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+            // 10__ continuation
+            two_conts, two_conts, two_conts, two_conts,
+            // 1100, 1101 two bytes lead
+            too_short | overlong_2, too_short,
+            // 1110 three bytes lead
+            too_short | overlong_3 | surrogate,
+            // 1111 four bytes lead
+            too_short | too_large | too_large_1000 | overlong_4), _HighNibbles(prev1));
+        __m128i byte_1_low = _mm_shuffle_epi8(_mm_setr_epi8(
+            carry | overlong_3 | overlong_2 | overlong_4,
+            carry | overlong_2,
+            carry,
+            carry,
+            carry | too_large,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000 | surrogate,
+            carry | too_large | too_large_1000,
+            carry | too_large | too_large_1000), _mm_and_si128(prev1, _mm_set1_epi8(0x0f)));
+        __m128i byte_2_high = _mm_shuffle_epi8(_mm_setr_epi8(
+            // 0___ ASCII
+            too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+            // 1000
+            too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+            // 1001
+            too_long | overlong_2 | two_conts | overlong_3 | too_large,
+            // 101_
+            too_long | overlong_2 | two_conts | surrogate | too_large,
+            too_long | overlong_2 | two_conts | surrogate | too_large,
+            // 11__ lead
+            too_short, too_short, too_short, too_short), _HighNibbles(input));
+        __m128i special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+        // Third and fourth bytes of a sequence must be continuations.
+        __m128i prev2 = _mm_alignr_epi8(input, _Previous, 14);
+        __m128i prev3 = _mm_alignr_epi8(input, _Previous, 13);
+        __m128i must_be_continuation = _mm_and_si128(
+            _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)), _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80))),
+            _mm_set1_epi8((char)0x80));
+
+        _Previous = input;
+        _Incomplete = _mm_subs_epu8(input, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xf0 - 1), (char)(0xe0 - 1), (char)(0xc0 - 1)));
+        return _mm_xor_si128(must_be_continuation, special_cases);
+    }
 
-    ValveDataObject& operator=(std::string&& value);
+public:
+    Utf8Validator() :
+        _Previous(_mm_setzero_si128()),
+        _Incomplete(_mm_setzero_si128())
+    {}
 
-    ValveDataObject& operator=(int32_t value);
+    /// <summary>
+    /// Checks the next bytes of the input, only the last call can have a size that is not a multiple of 16.
+    /// Returns the offset of the first invalid byte (0 when it ends the previous bytes), or size when there is none.
+    /// </summary>
+    inline size_t Check(const char* data, size_t size)
+    {
+        __m128i previous = _Previous;
+        __m128i error = _mm_setzero_si128();
+        size_t i = 0;
+
+        for (; size - i >= 16; i += 16)
+            error = _mm_or_si128(error, _Check(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))));
+
+        if (i != size)
+        {// Pad the end with nulls, a sequence that is not finished is then invalid.
+            char tail[16] = {};
+            memcpy(tail, data + i, size - i);
+            error = _mm_or_si128(error, _Check(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tail))));
+        }
 
-    ValveDataObject& operator=(pointer_t value);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xffff)
+            return size;
 
-    ValveDataObject& operator=(color_t value);
+        // Find the invalid byte, from the state the previous bytes left.
+        char before[16];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(before), previous);
+        Utf8State state;
+        for (int lead = 13; lead < 16; ++lead)
+        {
+            if ((unsigned char)before[lead] >= 0xc0)
+            {
+                state = Utf8State();
+                if (CheckUtf8(before + lead, 16 - lead, state) != (size_t)(16 - lead))
+                    return 0;
+            }
+        }
 
-    ValveDataObject& operator=(float value);
+        size_t offset = CheckUtf8(data, size, state);
+        return offset < size ? offset : size - 1;
+    }
 
-    ValveDataObject& operator=(int64_t value);
+    // Whether the input can end here, without an unfinished sequence.
+    inline bool Complete() const
+    {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_Incomplete, _mm_setzero_si128())) == 0xffff;
+    }
+#else
+    Utf8State _State;
 
-    ValveDataObject& operator=(uint64_t value);
+public:
+    inline size_t Check(const char* data, size_t size)
+    {
+        return CheckUtf8(data, size, _State);
+    }
 
-    int32_t Int32() const;
+    inline bool Complete() const
+    {
+        return _State.remaining == 0;
+    }
+#endif
+};
 
-    float Float() const;
+inline bool IsValidUtf8(const char* data, size_t size)
+{
+    Utf8Validator validator;
+    return validator.Check(data, size) == size && validator.Complete();
+}
 
-    pointer_t Pointer() const;
+inline void CheckBinaryString(StringView str)
+{
+    if (!IsValidUtf8(str.data(), str.size()))
+    {
+        throw ParserException("Invalid UTF-8 while parsing binary string");
+    }
+}
 
-    color_t Color() const;
+/// <summary>
+/// Appends the UTF-8 form of count UTF-16LE code units to str, the runs of ASCII are converted 8 code units at a time.
+/// Returns false on an unpaired surrogate.
+/// </summary>
+inline bool Utf16ToUtf8(const char* data, size_t count, std::string& str)
+{
+    size_t start = str.length();
+    // At most 3 bytes per code unit, a surrogate pair is 4 bytes for 2 of them.
+    str.resize(start + count * 3);
+    char* out = &str[0] + start;
+    size_t i = 0;
 
-    int64_t Int64() const;
+    while (i != count)
+    {
+#if defined(EASYVDF_USE_SSE2)
+        for (; count - i >= 8; i += 8, out += 8)
+        {
+            __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16((short)0xff80)), _mm_setzero_si128())) != 0xffff)
+                break;
 
-    uint64_t UInt64() const;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(units, units));
+        }
+#else
+        uint64_t word;
+        for (; count - i >= 4 && (memcpy(&word, data + i * 2, 8), (word & 0xff80ff80ff80ff80ull) == 0); i += 4, out += 4)
+        {
+            out[0] = (char)word;
+            out[1] = (char)(word >> 16);
+            out[2] = (char)(word >> 32);
+            out[3] = (char)(word >> 48);
+        }
+#endif
+        if (i == count)
+            break;
 
-    ValveCollectionRef operator[](const char* key);
-    
-    ValveCollectionRef operator[](std::string const& key);
-    
-    ValveCollectionConstRef operator[](const char* key) const;
+        uint32_t c = (uint8_t)data[i * 2] | ((uint32_t)(uint8_t)data[i * 2 + 1] << 8);
+        ++i;
+        if (c >= 0xd800 && c <= 0xdfff)
+        {
+            if (c >= 0xdc00 || i == count)
+                return false;
 
-    ValveCollectionConstRef operator[](std::string const& key) const;
+            uint32_t low = (uint8_t)data[i * 2] | ((uint32_t)(uint8_t)data[i * 2 + 1] << 8);
+            if (low < 0xdc00 || low > 0xdfff)
+                return false;
 
-    inline std::string SerializeAsText() const;
+            ++i;
+            c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+        }
 
-    inline std::string SerializeAsBinary(int version = 0) const;
+        if (c < 0x80)
+        {
+            *out++ = (char)c;
+        }
+        else if (c < 0x800)
+        {
+            *out++ = (char)(0xc0 | (c >> 6));
+            *out++ = (char)(0x80 | (c & 0x3f));
+        }
+        else if (c < 0x10000)
+        {
+            *out++ = (char)(0xe0 | (c >> 12));
+            *out++ = (char)(0x80 | ((c >> 6) & 0x3f));
+            *out++ = (char)(0x80 | (c & 0x3f));
+        }
+        else
+        {
+            *out++ = (char)(0xf0 | (c >> 18));
+            *out++ = (char)(0x80 | ((c >> 12) & 0x3f));
+            *out++ = (char)(0x80 | ((c >> 6) & 0x3f));
+            *out++ = (char)(0x80 | (c & 0x3f));
+        }
+    }
 
-    inline void SerializeAsText(std::ostream& os) const;
+    str.resize(out - str.data());
+    return true;
+}
 
-    inline void SerializeAsBinary(std::ostream& os, int version = 0) const;
+/// <summary>
+/// Appends the UTF-16LE code units of a UTF-8 string to str, the runs of ASCII are converted 16 bytes at a time.
+/// Returns false when the string isn't valid UTF-8.
+/// </summary>
+inline bool Utf8ToUtf16(StringView utf8, std::string& str)
+{
+    if (!IsValidUtf8(utf8.data(), utf8.size()))
+        return false;
 
-    static ValveDataObject ParseObject(std::istream& is, size_t chunk_size = 10 * 1024);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(utf8.data());
+    const unsigned char* e = p + utf8.size();
+    size_t start = str.length();
+    // At most 2 bytes per byte, a 4 bytes sequence is a surrogate pair.
+    str.resize(start + utf8.size() * 2);
+    char* out = &str[0] + start;
+
+    while (p != e)
+    {
+#if defined(EASYVDF_USE_SSE2)
+        for (; e - p >= 16; p += 16, out += 32)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            if (_mm_movemask_epi8(bytes) != 0)
+                break;
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(bytes, _mm_setzero_si128()));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(bytes, _mm_setzero_si128()));
+        }
+        if (p == e)
+            break;
+#endif
+        // The sequences are valid.
+        uint32_t c = *p++;
+        if (c >= 0xf0)
+        {
+            c = ((c & 0x07) << 18) | ((uint32_t)(p[0] & 0x3f) << 12) | ((uint32_t)(p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+            p += 3;
+        }
+        else if (c >= 0xe0)
+        {
+            c = ((c & 0x0f) << 12) | ((uint32_t)(p[0] & 0x3f) << 6) | (p[1] & 0x3f);
+            p += 2;
+        }
+        else if (c >= 0xc0)
+        {
+            c = ((c & 0x1f) << 6) | (p[0] & 0x3f);
+            p += 1;
+        }
+
+        if (c >= 0x10000)
+        {
+            c -= 0x10000;
+            uint32_t high = 0xd800 + (c >> 10);
+            *out++ = (char)high;
+            *out++ = (char)(high >> 8);
+            c = 0xdc00 + (c & 0x3ff);
+        }
+        *out++ = (char)c;
+        *out++ = (char)(c >> 8);
+    }
+
+    str.resize(out - str.data());
+    return true;
+}
+
+/// <summary>
+/// Sets str to the UTF-8 form of the code units of a binary wide string, throws on an unpaired surrogate.
+/// </summary>
+inline void DecodeBinaryWideString(const char* data, size_t size, std::string& str)
+{
+    str.clear();
+    if (!Utf16ToUtf8(data, size / 2, str))
+    {
+        throw ParserException("Invalid UTF-16 while parsing binary wide string");
+    }
+}
+
+/// <summary>
+/// First stage of the text parser: finds the structural characters of consecutive 64 bytes blocks.
+/// Structural characters are the unescaped quotes, and outside of strings, the braces and the start of unquoted datas.
+/// </summary>
+class StructuralIndexer
+{
+    uint64_t _PrevEscaped;
+    uint64_t _PrevInString;
+    uint64_t _PrevData;
+    uint64_t _PrevCr;
+
+    // Returns the characters escaped by a backslash (an odd backslash sequence escapes the following character).
+    inline uint64_t _FindEscaped(uint64_t backslash)
+    {
+        const uint64_t even_bits = 0x5555555555555555ull;
+
+        backslash &= ~_PrevEscaped;
+        uint64_t follows_escape = (backslash << 1) | _PrevEscaped;
+        uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+        uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+        _PrevEscaped = sequences_starting_on_even_bits < odd_sequence_starts ? 1 : 0;
+        uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+
+        return (even_bits ^ invert_mask) & follows_escape;
+    }
+
+public:
+    StructuralIndexer() :
+        _PrevEscaped(0),
+        _PrevInString(0),
+        _PrevData(0),
+        _PrevCr(0)
+    {}
+
+    // Starts inside of the input, after an odd backslash sequence (escaped) and/or inside of a string.
+    StructuralIndexer(bool escaped, bool in_string) :
+        _PrevEscaped(escaped ? 1 : 0),
+        _PrevInString(in_string ? ~0ull : 0),
+        _PrevData(0),
+        _PrevCr(0)
+    {}
+
+    // On return, block.quote only holds the unescaped quotes, the braces only those outside of strings
+    // and block.lf holds one bit per EOL (CRLF being counted once).
+    inline uint64_t Index(TextBlock& block)
+    {
+        block.quote &= ~_FindEscaped(block.backslash);
+
+        // Quoted regions, opening quote included, closing quote excluded.
+        uint64_t in_string = PrefixXor(block.quote) ^ _PrevInString;
+        _PrevInString = (uint64_t)((int64_t)in_string >> 63);
+
+        uint64_t data = ~(block.whitespace | block.open_brace | block.close_brace | block.quote);
+        uint64_t data_start = data & ~((data << 1) | _PrevData);
+        _PrevData = data >> 63;
+
+        uint64_t eol = block.cr | (block.lf & ~((block.cr << 1) | _PrevCr));
+        _PrevCr = block.cr >> 63;
+        block.lf = eol;
+
+        block.open_brace &= ~in_string;
+        block.close_brace &= ~in_string;
+
+        return block.quote | block.open_brace | block.close_brace | (data_start & ~in_string);
+    }
 };
 
+enum class TextToken
+{
+    End,
+    String,
+    Data,
+    ObjectStart,
+    ObjectEnd,
+    UnterminatedString,
+    NeedMore,
+};
 
-/////////////////////////////////////////////////////////////////////
-// 
-//                        ValveDataObjectRef
-// 
-/////////////////////////////////////////////////////////////////////
+/// <summary>
+/// Second stage of the text parser: walks the structural characters and returns the tokens, in a single pass.
+/// The scanner works on a window of datas that can be extended (Feed) and trimmed at the front (Discard),
+/// when it runs out of datas before the end of the input, it returns NeedMore and resumes where it stopped on the next call.
+/// Tokens offsets are relative to the window and are only valid until the next call to Next.
+/// </summary>
+class TextScanner
+{
+    enum class Pending : uint8_t
+    {
+        None,
+        String,
+        Data,
+    };
 
-template<typename T>
-ValveDataObjectRefWrapper<T>::ValveDataObjectRefWrapper(T* obj):
-    _Obj(obj)
-{}
+    const char* _Data;
+    size_t _Size;
+    bool _Final;
+
+    // Offset of the block the bitmasks belong to, and end of the indexed datas.
+    size_t _BlockOffset;
+    size_t _Indexed;
+    uint64_t _Structurals;
+    uint64_t _OpenBraces;
+    uint64_t _CloseBraces;
+    uint64_t _Eols;
+    uint64_t _Backslashes;
+    // Lines before the current block
+    uint32_t _Lines;
+    StructuralIndexer _Indexer;
+    bool _ValidateUtf8;
+    Utf8Validator _Utf8;
+
+    Pending _Pending;
+    size_t _TokenStart;
+    size_t _DataEnd;
+    bool _DataEscaped;
+    // Whether the pending string contains backslashes, and whether the last token did
+    bool _StringEscaped;
+    bool _TokenEscaped;
+
+    void _CheckUtf8(const char* p, uint64_t eols)
+    {
+        size_t offset = _Utf8.Check(p, 64);
+        if (offset != 64)
+        {
+            throw ParserException("Invalid UTF-8 at line " + std::to_string(_Lines + PopCount64(eols & ((1ull << offset) - 1)) + 1));
+        }
+    }
 
-template<typename T>
-ValveDataObjectRefWrapper<T>::ValveDataObjectRefWrapper(ValveDataObjectRefWrapper<T> const& o):
-    _Obj(o._Obj)
-{}
+    bool _IndexBlock()
+    {
+        size_t left = _Size - _Indexed;
+        if (left == 0 || (left < 64 && !_Final))
+        {
+            if (left == 0 && _Final && _ValidateUtf8 && !_Utf8.Complete())
+            {
+                throw ParserException("Invalid UTF-8 at line " + std::to_string(_Lines + PopCount64(_Eols) + 1));
+            }
+            return false;
+        }
 
-template<typename T>
-inline std::string const& ValveDataObjectRefWrapper<T>::Name() const
+        TextBlock block;
+        char tail[64];
+        const char* p = _Data + _Indexed;
+        if (left < 64)
+        {// Pad the last block with spaces
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p, left);
+            p = tail;
+        }
+        ClassifyTextBlock(p, block);
+
+        if (_Pending == Pending::String && _TokenStart < _BlockOffset)
+        {// The block is fully inside the pending string
+            _StringEscaped |= _Backslashes != 0;
+        }
+
+        _Lines += PopCount64(_Eols);
+        _BlockOffset = _Indexed;
+        _Indexed += left >= 64 ? 64 : left;
+        _Backslashes = block.backslash;
+        _Structurals = _Indexer.Index(block);
+        _OpenBraces = block.open_brace;
+        _CloseBraces = block.close_brace;
+        _Eols = block.lf;
+        if (_ValidateUtf8)
+            _CheckUtf8(p, _Eols);
+
+        return true;
+    }
+
+    bool _NextStructural(size_t& offset)
+    {
+        while (_Structurals == 0)
+        {
+            if (!_IndexBlock())
+                return false;
+        }
+
+        offset = _BlockOffset + CountTrailingZeros64(_Structurals);
+        _Structurals &= _Structurals - 1;
+        return true;
+    }
+
+public:
+    // first_line is the line number of the datas, when they start inside of a document.
+    TextScanner(uint32_t first_line = 1, bool validate_utf8 = false) :
+        _Data(nullptr),
+        _Size(0),
+        _Final(false),
+        _BlockOffset(0),
+        _Indexed(0),
+        _Structurals(0),
+        _OpenBraces(0),
+        _CloseBraces(0),
+        _Eols(0),
+        _Backslashes(0),
+        _Lines(first_line - 1),
+        _ValidateUtf8(validate_utf8),
+        _Pending(Pending::None),
+        _TokenStart(0),
+        _DataEnd(0),
+        _DataEscaped(false),
+        _StringEscaped(false),
+        _TokenEscaped(false)
+    {}
+
+    // Sets the window, it must start with the datas that were not discarded.
+    inline void Feed(const char* data, size_t size, bool final)
+    {
+        _Data = data;
+        _Size = size;
+        _Final = final;
+    }
+
+    // Number of bytes at the front of the window that are not needed anymore.
+    inline size_t Discardable() const
+    {
+        size_t keep = _BlockOffset;
+        if (_Pending != Pending::None && _TokenStart < keep)
+            keep = _TokenStart;
+
+        return keep;
+    }
+
+    inline void Discard(size_t count)
+    {
+        _BlockOffset -= count;
+        _Indexed -= count;
+        _TokenStart -= _Pending != Pending::None ? count : 0;
+        _DataEnd -= _Pending == Pending::Data ? count : 0;
+        _Size -= count;
+    }
+
+    // Whether the content of the last String or Data token has backslashes.
+    inline bool HasEscape() const
+    {
+        return _TokenEscaped;
+    }
+
+    // Line of the last token.
+    inline uint32_t Line() const
+    {
+        if (_TokenStart < _BlockOffset)
+            return _Lines + 1;
+
+        size_t bit = _TokenStart - _BlockOffset;
+        if (bit >= 64)
+            return _Lines + PopCount64(_Eols) + 1;
+
+        return _Lines + PopCount64(_Eols & ((1ull << bit) - 1)) + 1;
+    }
+
+    // For String and Data tokens, token_start and token_end are set to the token content, for braces to the brace.
+    // An unterminated string content goes to the end of the input.
+    inline TextToken Next(size_t& token_start, size_t& token_end)
+    {
+        size_t offset;
+
+        if (_Pending == Pending::None)
+        {
+            if (!_NextStructural(offset))
+                return _Final ? TextToken::End : TextToken::NeedMore;
+
+            _TokenStart = offset;
+            switch (_Data[offset])
+            {
+                case '{': token_start = offset; token_end = offset + 1; return TextToken::ObjectStart;
+                case '}': token_start = offset; token_end = offset + 1; return TextToken::ObjectEnd;
+                case '"':
+                    _Pending = Pending::String;
+                    // Backslashes after the opening quote in this block
+                    _StringEscaped = (_Backslashes & ~((2ull << (offset - _BlockOffset)) - 1)) != 0;
+                    break;
+
+                default : _Pending = Pending::Data; _DataEnd = offset; _DataEscaped = false; _TokenEscaped = false; break;
+            }
+        }
+
+        if (_Pending == Pending::String)
+        {// Everything in the string is masked, the next structural is the closing quote.
+            if (!_NextStructural(offset))
+            {
+                if (!_Final)
+                    return TextToken::NeedMore;
+
+                _Pending = Pending::None;
+                token_start = _TokenStart + 1;
+                token_end = _Size;
+                return TextToken::UnterminatedString;
+            }
+
+            uint64_t before_end = _Backslashes & ((1ull << (offset - _BlockOffset)) - 1);
+            if (_TokenStart >= _BlockOffset)
+            {// Opening and closing quotes are in the same block
+                _TokenEscaped = (before_end & ~((2ull << (_TokenStart - _BlockOffset)) - 1)) != 0;
+            }
+            else
+            {
+                _TokenEscaped = _StringEscaped || before_end != 0;
+            }
+
+            _Pending = Pending::None;
+            token_start = _TokenStart + 1;
+            token_end = offset;
+            return TextToken::String;
+        }
+
+        // Unquoted datas end on the next space, unescaped quote or brace.
+        while (_DataEnd != _Size)
+        {
+            char c = _Data[_DataEnd];
+            if (c == ' ' || c == '\t' || is_cr(c) || is_lf(c) || c == '{' || c == '}' || (c == '"' && !_DataEscaped))
+                break;
+
+            _DataEscaped = c == '\\' && !_DataEscaped;
+            _TokenEscaped |= _DataEscaped;
+            ++_DataEnd;
+        }
+        if (_DataEnd == _Size && !_Final)
+            return TextToken::NeedMore;
+
+        _Pending = Pending::None;
+        token_start = _TokenStart;
+        token_end = _DataEnd;
+        return TextToken::Data;
+    }
+
+    /// <summary>
+    /// Skips the content of objects without returning their tokens, by counting the braces of each block.
+    /// depth is the number of objects left to close, it is kept when NeedMore is returned so the skip can be resumed.
+    /// Returns ObjectEnd once the last of them was closed.
+    /// </summary>
+    inline TextToken SkipObject(uint32_t& depth)
+    {
+        for (;;)
+        {
+            uint64_t open = _OpenBraces & _Structurals;
+            uint64_t close = _CloseBraces & _Structurals;
+            if (PopCount64(close) < depth)
+            {// The objects don't end in this block
+                depth = depth + PopCount64(open) - PopCount64(close);
+            }
+            else
+            {
+                uint64_t braces = open | close;
+                while (braces != 0)
+                {
+                    uint64_t bit = braces & (0 - braces);
+                    braces ^= bit;
+                    if ((open & bit) != 0)
+                    {
+                        ++depth;
+                    }
+                    else if (--depth == 0)
+                    {
+                        _Structurals &= ~((bit << 1) - 1);
+                        _TokenStart = _BlockOffset + CountTrailingZeros64(bit);
+                        return TextToken::ObjectEnd;
+                    }
+                }
+            }
+
+            _Structurals = 0;
+            if (!_IndexBlock())
+                return _Final ? TextToken::End : TextToken::NeedMore;
+        }
+    }
+};
+
+class BufferTextSource
 {
-    return _Obj->Name();
+    const char* _Data;
+    TextScanner _Scanner;
+
+public:
+    // The tokens stay valid until the end of the parse.
+    static constexpr bool stable_tokens = true;
+
+    // first_line is the line number of data, when it starts inside of a document.
+    BufferTextSource(const char* data, size_t size, uint32_t first_line = 1, bool validate_utf8 = false) :
+        _Data(data),
+        _Scanner(first_line, validate_utf8)
+    {
+        _Scanner.Feed(data, size, true);
+    }
+
+    inline TextToken Next(const char*& token_start, const char*& token_end)
+    {
+        size_t start = 0, end = 0;
+        TextToken token = _Scanner.Next(start, end);
+        token_start = _Data + start;
+        token_end = _Data + end;
+        return token;
+    }
+
+    // Skips up to the end of the object whose start was just read, returns false on premature end of input.
+    inline bool SkipObject()
+    {
+        uint32_t depth = 1;
+        return _Scanner.SkipObject(depth) == TextToken::ObjectEnd;
+    }
+
+    inline bool HasEscape() const
+    {
+        return _Scanner.HasEscape();
+    }
+
+    inline uint32_t Line() const
+    {
+        return _Scanner.Line();
+    }
+};
+
+enum class DirectiveType : uint8_t
+{
+    // The fragment provides the keys that are missing from the document.
+    Base,
+    // The fragment members are added to the document.
+    Include,
+};
+
+struct TextDirective
+{
+    DirectiveType type;
+    std::string path;
+};
+
+// A file read to apply the directives, with the modification time it had.
+struct IncludeDependency
+{
+    std::string path;
+    int64_t mtime;
+};
+
+struct IncludeState
+{
+    // The files being loaded, an inclusion of one of them is recursive.
+    std::vector<std::string> loading;
+    // The files loaded so far, included ones first.
+    std::vector<IncludeDependency> dependencies;
+};
+
+// Whether the token is a [$CONDITION].
+inline bool IsConditionToken(TextToken token, const char* token_start, const char* token_end)
+{
+    return token == TextToken::Data && token_end - token_start >= 2 && token_start[0] == '[' && token_end[-1] == ']';
 }
 
-template<typename T>
-inline ObjectType ValveDataObjectRefWrapper<T>::Type() const
+/// <summary>
+/// Evaluates a condition like [$WIN32], [!$X360] or [$WIN32||$OSX&&!$X360] against the defined symbols, case insensitively.
+/// Returns false when the condition is malformed.
+/// </summary>
+inline bool EvaluateCondition(StringView condition, std::vector<std::string> const& defines, bool& value)
 {
-    return _Obj->Type();
+    const char* p = condition.data() + 1;
+    const char* end = condition.data() + condition.size() - 1;
+    bool result = false;
+    bool term = true;
+
+    for (;;)
+    {
+        bool negate = false;
+        while (p != end && *p == '!')
+        {
+            negate = !negate;
+            ++p;
+        }
+        if (p == end || *p != '$')
+            return false;
+
+        const char* name = ++p;
+        while (p != end && *p != '|' && *p != '&')
+            ++p;
+
+        bool defined = false;
+        for (auto const& define : defines)
+        {
+            if (define.length() != (size_t)(p - name))
+                continue;
+
+            size_t i = 0;
+            while (i != define.length() && tolower((unsigned char)define[i]) == tolower((unsigned char)name[i]))
+                ++i;
+
+            if (i == define.length())
+            {
+                defined = true;
+                break;
+            }
+        }
+        term = term && defined != negate;
+
+        if (p == end)
+        {
+            value = result || term;
+            return true;
+        }
+
+        if (end - p < 2 || p[1] != p[0])
+            return false;
+
+        if (*p == '|')
+        {// && binds tighter than ||
+            result = result || term;
+            term = true;
+        }
+        p += 2;
+    }
+}
+
+// Content of the last String or Data token, only the tokens with backslashes go through the escape decoding into buffer.
+// Unescaped tokens point into the source unless copy is set.
+template<typename TextSource>
+inline StringView ReadTokenString(TextSource const& source, const char* token_start, const char* token_end, bool escape_sequences, bool copy, std::string& buffer)
+{
+    if (escape_sequences && source.HasEscape())
+    {
+        UnescapeString(token_start, token_end, buffer);
+        return StringView(buffer);
+    }
+    if (copy)
+    {
+        buffer.assign(token_start, token_end);
+        return StringView(buffer);
+    }
+
+    return StringView(token_start, token_end - token_start);
+}
+
+// Whether the 8 bytes are decimal digits, word gets them as a little endian integer.
+inline bool IsEightDigits(const char* p, uint64_t& word)
+{
+    memcpy(&word, p, sizeof(word));
+    return ((word & 0xf0f0f0f0f0f0f0f0ull) | (((word + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+// Value of 8 decimal digits, combined by pairs in the lanes of the word.
+inline uint32_t ParseEightDigits(uint64_t word)
+{
+    word = ((word & 0x0f0f0f0f0f0f0f0full) * 2561) >> 8;
+    word = ((word & 0x00ff00ff00ff00ffull) * 6553601) >> 16;
+    return (uint32_t)(((word & 0x0000ffff0000ffffull) * 42949672960001ull) >> 32);
+}
+
+/// <summary>
+/// Typed value of a text value: integers become Int32, Int64 or UInt64 and decimals become Float,
+/// only when the serializer writes them back as the same text (no sign or leading zeros, at most 6 significant digits for floats, ...).
+/// Anything else stays a string.
+/// </summary>
+inline ValveDataValue InferTextValue(StringView text)
+{
+    static const double powers_of_10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
+
+    const char* p = text.data();
+    const char* end = p + text.size();
+    bool negative = p != end && *p == '-';
+    if (negative)
+        ++p;
+
+    const char* digits = p;
+    uint64_t integer = 0;
+    uint64_t word;
+    // 16 digits always fit, the others are checked one by one.
+    while (end - p >= 8 && p - digits < 16 && IsEightDigits(p, word))
+    {
+        integer = integer * 100000000 + ParseEightDigits(word);
+        p += 8;
+    }
+    while (p != end && *p >= '0' && *p <= '9')
+    {
+        uint32_t digit = *p - '0';
+        if (integer > (UINT64_MAX - digit) / 10)
+            return ValveDataValue(text);
+
+        integer = integer * 10 + digit;
+        ++p;
+    }
+
+    size_t integer_digits = p - digits;
+    if (integer_digits == 0 || (integer_digits > 1 && *digits == '0'))
+        return ValveDataValue(text);
+
+    if (p == end)
+    {
+        if (negative)
+        {
+            if (integer == 0 || integer > (uint64_t)INT64_MAX + 1)
+                return ValveDataValue(text);
+
+            if (integer <= (uint64_t)INT32_MAX + 1)
+                return ValveDataValue((int32_t)(0 - (int64_t)(integer - 1) - 1));
+
+            return ValveDataValue((int64_t)(0 - (int64_t)(integer - 1) - 1));
+        }
+
+        if (integer <= (uint64_t)INT32_MAX)
+            return ValveDataValue((int32_t)integer);
+
+        if (integer <= (uint64_t)INT64_MAX)
+            return ValveDataValue((int64_t)integer);
+
+        return ValveDataValue(integer);
+    }
+
+    if (*p != '.')
+        return ValveDataValue(text);
+
+    const char* fraction = ++p;
+    uint64_t mantissa = integer;
+    while (p != end && *p >= '0' && *p <= '9' && p - fraction < 9)
+    {
+        mantissa = mantissa * 10 + (*p - '0');
+        ++p;
+    }
+
+    // Trailing zeros and exponents are not written back.
+    size_t fraction_digits = p - fraction;
+    if (p != end || fraction_digits == 0 || fraction_digits > 8 || p[-1] == '0')
+        return ValveDataValue(text);
+
+    size_t significant_digits = integer_digits + fraction_digits;
+    if (integer == 0)
+    {
+        size_t leading_zeros = 0;
+        while (fraction[leading_zeros] == '0')
+            ++leading_zeros;
+
+        // Smaller values are written with an exponent.
+        if (leading_zeros > 3)
+            return ValveDataValue(text);
+
+        significant_digits = fraction_digits - leading_zeros;
+    }
+    if (significant_digits > 6)
+        return ValveDataValue(text);
+
+    // Both are exact as doubles, and the quotient is far enough from a float midpoint to round correctly.
+    float value = (float)((double)mantissa / powers_of_10[fraction_digits]);
+    return ValveDataValue(negative ? -value : value);
+}
+
+inline ValveDataValue TextValue(StringView text, ParseOptions const& options)
+{
+    return options.infer_types ? InferTextValue(text) : ValveDataValue(text);
+}
+
+/// <summary>
+/// Reads the stream by blocks, only the datas of the token being parsed are kept between two reads.
+/// </summary>
+class StreamTextSource
+{
+    std::istream& _Is;
+    std::string& _Buffer;
+    size_t _Size;
+    TextScanner _Scanner;
+
+    void _Fill()
+    {
+        size_t discard = _Scanner.Discardable();
+        if (discard != 0)
+        {
+            memmove(&_Buffer[0], &_Buffer[discard], _Size - discard);
+            _Size -= discard;
+            _Scanner.Discard(discard);
+        }
+        if (_Size == _Buffer.length())
+        {// The token doesn't fit in the block
+            _Buffer.resize(_Buffer.length() * 2);
+        }
+
+        size_t wanted = _Buffer.length() - _Size;
+        _Is.read(&_Buffer[_Size], wanted);
+        _Size += (size_t)_Is.gcount();
+        _Scanner.Feed(_Buffer.data(), _Size, (size_t)_Is.gcount() != wanted);
+    }
+
+public:
+    // The buffer is compacted on reads, the tokens are only valid until the next one.
+    static constexpr bool stable_tokens = false;
+
+    // The first size bytes of buffer were already read from the stream.
+    StreamTextSource(std::istream& is, std::string& buffer, bool validate_utf8 = false, size_t size = 0) :
+        _Is(is),
+        _Buffer(buffer),
+        _Size(size),
+        _Scanner(1, validate_utf8)
+    {
+        if (_Buffer.empty())
+            _Buffer.resize(1);
+
+        _Scanner.Feed(_Buffer.data(), _Size, false);
+    }
+
+    inline TextToken Next(const char*& token_start, const char*& token_end)
+    {
+        size_t start = 0, end = 0;
+        TextToken token;
+        while ((token = _Scanner.Next(start, end)) == TextToken::NeedMore)
+            _Fill();
+
+        token_start = _Buffer.data() + start;
+        token_end = _Buffer.data() + end;
+        return token;
+    }
+
+    // Skips up to the end of the object whose start was just read, returns false on premature end of input.
+    inline bool SkipObject()
+    {
+        uint32_t depth = 1;
+        TextToken token;
+        while ((token = _Scanner.SkipObject(depth)) == TextToken::NeedMore)
+            _Fill();
+
+        return token == TextToken::ObjectEnd;
+    }
+
+    inline bool HasEscape() const
+    {
+        return _Scanner.HasEscape();
+    }
+
+    inline uint32_t Line() const
+    {
+        return _Scanner.Line();
+    }
+};
+
+}
+
+class SerializeException : public std::exception
+{
+    const char* _Msg;
+public:
+    SerializeException(const char* msg):
+        _Msg(msg)
+    {}
+
+    virtual char const* what() const noexcept
+    {
+        return _Msg;
+    }
+};
+
+template<typename T>
+class ValveDataObjectRefWrapper
+{
+    T* _Obj;
+
+public:
+    ValveDataObjectRefWrapper(T*);
+
+    ValveDataObjectRefWrapper(ValveDataObjectRefWrapper<T> const& o);
+
+    inline std::string const& Name() const;
+
+    inline ObjectType Type() const;
+
+    inline bool Empty() const;
+
+    inline std::string& String();
+
+    inline std::string const& String() const;
+
+    inline std::string& WideString();
+
+    inline std::string const& WideString() const;
+
+    inline std::string& Binary();
+
+    inline std::string const& Binary() const;
+
+    inline ValveCollection& Collection();
+
+    inline ValveCollection const& Collection() const;
+
+    inline bool operator==(std::nullptr_t);
+
+    inline ValveDataObjectRefWrapper& operator=(ValveDataObjectRefWrapper const&);
+
+    inline ValveDataObjectRefWrapper& operator=(ValveDataObjectRefWrapper &&);
+
+    inline ValveDataObjectRefWrapper& operator=(T const&);
+
+    inline ValveDataObjectRefWrapper& operator=(T&&);
+
+    inline ValveDataObjectRefWrapper& operator=(std::nullptr_t);
+
+    inline ValveDataObjectRefWrapper& operator=(std::string const& value);
+
+    inline ValveDataObjectRefWrapper& operator=(std::string&& value);
+
+    inline ValveDataObjectRefWrapper& operator=(int32_t value);
+
+    inline ValveDataObjectRefWrapper& operator=(pointer_t value);
+
+    inline ValveDataObjectRefWrapper& operator=(color_t value);
+
+    inline ValveDataObjectRefWrapper& operator=(float value);
+
+    inline ValveDataObjectRefWrapper& operator=(int64_t value);
+
+    inline ValveDataObjectRefWrapper& operator=(uint64_t value);
+
+    inline ValveDataObjectRefWrapper& operator=(wide_string_t value);
+
+    inline ValveDataObjectRefWrapper& operator=(binary_t value);
+
+    inline int32_t Int32() const;
+
+    inline float Float() const;
+
+    inline pointer_t Pointer() const;
+
+    inline color_t Color() const;
+
+    inline int64_t Int64() const;
+
+    inline uint64_t UInt64() const;
+
+    inline ValveCollectionRef operator[](const char* key);
+
+    inline ValveCollectionRef operator[](std::string const& key);
+
+    inline ValveCollectionConstRef operator[](const char* key) const;
+
+    inline ValveCollectionConstRef operator[](std::string const& key) const;
+
+    inline std::string SerializeAsText(bool escape_sequences = true) const;
+
+    inline std::string SerializeAsBinary(int version = 0) const;
+
+    inline void SerializeAsText(std::ostream& os, bool escape_sequences = true) const;
+
+    inline void SerializeAsBinary(std::ostream& os, int version = 0) const;
+};
+
+class ValveDataObject
+{
+private:
+    using BinaryNodeType = Details::BinaryNodeType;
+
+    class Data_t
+    {
+        friend class ValveDataObject;
+        friend class ValveDataObjectBuilder;
+
+        std::string _Name;
+        size_t _NameHash;
+        union
+        {
+            // String, WideString (in UTF-8) and Binary.
+            std::string* _String;
+            ValveCollection* _Collection;
+            int32_t _Int32;
+            float _Float;
+            pointer_t _Pointer;
+            color_t _Color;
+            int64_t _Int64;
+            uint64_t _UInt64;
+        } _U;
+        ObjectType _Type;
+
+    public:
+        Data_t() :
+            _Name(),
+            _NameHash(std::hash<std::string>()(_Name)),
+            _Type(ObjectType::None)
+        {}
+    };
+
+    friend class ValveDataObjectBuilder;
+
+    Data_t *_Obj;
+
+    void _ResetValue();
+
+    static void _WriteTextString(std::ostream& os, std::string const& str, bool escape_sequences);
+
+    void _SerializeAsText(std::ostream& os, size_t depth, bool escape_sequences) const;
+
+    void _SerializeAsBinary(std::ostream& os, BinaryNodeType object_end) const;
+
+    void _MergeBase(ValveDataObject const& base);
+
+    void _ApplyDirectives(std::vector<Details::TextDirective> const& directives, std::string const& from, ParseOptions const& options, Details::IncludeState& state);
+
+    static ValveDataObject _ParseFragment(std::string const& content, std::string const& path, ParseOptions const& options, Details::IncludeState& state);
+
+    static std::shared_ptr<const ValveDataObject> _LoadFragment(std::string const& path, ParseOptions const& options, Details::IncludeState& state);
+
+public:
+    ValveDataObject();
+
+    ValveDataObject(ValveDataObject const& other);
+
+    ValveDataObject(ValveDataObject&& other) noexcept;
+    
+    ValveDataObject(std::string const& key);
+    
+    ValveDataObject(std::string const& key, ValveDataObject const& other);
+
+    ValveDataObject(std::string const& key, ValveDataObject&& other) noexcept;
+
+    ValveDataObject(std::string const& key, std::string const& value);
+
+    ValveDataObject(std::string const& key, std::string&& value);
+
+    ValveDataObject(std::string const& key, int32_t value);
+
+    ValveDataObject(std::string const& key, float value);
+
+    ValveDataObject(std::string const& key, pointer_t value);
+
+    ValveDataObject(std::string const& key, color_t value);
+
+    ValveDataObject(std::string const& key, int64_t value);
+
+    ValveDataObject(std::string const& key, uint64_t value);
+
+    ValveDataObject(std::string const& key, wide_string_t value);
+
+    ValveDataObject(std::string const& key, binary_t value);
+
+    ~ValveDataObject();
+
+    inline void Name(std::string const& value);
+
+    inline void Name(std::string && value);
+
+    inline std::string const& Name() const;
+
+    inline ObjectType Type() const;
+
+    inline bool Empty() const;
+
+    std::string& String();
+
+    std::string const& String() const;
+
+    // UTF-8 text of a WideString.
+    std::string& WideString();
+
+    std::string const& WideString() const;
+
+    std::string& Binary();
+
+    std::string const& Binary() const;
+
+    ValveCollection& Collection();
+
+    ValveCollection const& Collection() const;
+
+    inline bool operator==(std::nullptr_t);
+
+    ValveDataObject& operator=(ValveDataObject const& other);
+
+    ValveDataObject& operator=(ValveDataObject&& other) noexcept;
+
+    ValveDataObject& operator=(std::nullptr_t);
+
+    ValveDataObject& operator=(std::string const& value);
+
+    ValveDataObject& operator=(std::string&& value);
+
+    ValveDataObject& operator=(int32_t value);
+
+    ValveDataObject& operator=(pointer_t value);
+
+    ValveDataObject& operator=(color_t value);
+
+    ValveDataObject& operator=(float value);
+
+    ValveDataObject& operator=(int64_t value);
+
+    ValveDataObject& operator=(uint64_t value);
+
+    ValveDataObject& operator=(wide_string_t value);
+
+    ValveDataObject& operator=(binary_t value);
+
+    int32_t Int32() const;
+
+    float Float() const;
+
+    pointer_t Pointer() const;
+
+    color_t Color() const;
+
+    int64_t Int64() const;
+
+    uint64_t UInt64() const;
+
+    ValveCollectionRef operator[](const char* key);
+    
+    ValveCollectionRef operator[](std::string const& key);
+    
+    ValveCollectionConstRef operator[](const char* key) const;
+
+    ValveCollectionConstRef operator[](std::string const& key) const;
+
+    // Without escape_sequences, the strings are written as is, like ParseOptions::escape_sequences parses them back.
+    inline std::string SerializeAsText(bool escape_sequences = true) const;
+
+    inline std::string SerializeAsBinary(int version = 0) const;
+
+    inline void SerializeAsText(std::ostream& os, bool escape_sequences = true) const;
+
+    inline void SerializeAsBinary(std::ostream& os, int version = 0) const;
+
+    static ValveDataObject ParseObject(std::istream& is, size_t chunk_size = 10 * 1024);
+
+    static ValveDataObject ParseObject(std::istream& is, ParseOptions const& options);
+
+    // Parses a VDF (text or binary) that is already in memory, no copy of the input is made.
+    static ValveDataObject ParseObject(const char* data, size_t size);
+
+    static ValveDataObject ParseObject(const char* data, size_t size, ParseOptions const& options);
+
+    // Lint parse: the errors are added to diagnostics instead of thrown, and the parse goes on after them.
+    // Returns what could be parsed. Text VDF is checked in a single pass, binary VDF stops at the first error.
+    static ValveDataObject ParseObject(const char* data, size_t size, std::vector<ParseDiagnostic>& diagnostics, ParseOptions const& options = ParseOptions());
+
+    // Parses a VDF file, its #base and #include directives are relative to it.
+    // Without options.resolver, the files are read with a ValveDataFileResolver.
+    static ValveDataObject ParseFile(std::string const& path, ParseOptions const& options = ParseOptions());
+};
+
+/// <summary>
+/// Finds and reads the files named by the #base and #include directives of text VDF.
+/// </summary>
+class ValveDataResolver
+{
+public:
+    virtual ~ValveDataResolver()
+    {}
+
+    // Path of the file named by a directive of the file at from, from is empty for a document that is not a file.
+    virtual std::string Resolve(std::string const& from, std::string const& name) = 0;
+
+    // Modification time of the file, returns false when it doesn't exist.
+    virtual bool Stat(std::string const& path, int64_t& mtime) = 0;
+
+    // Reads the whole file, returns false on failure.
+    virtual bool Read(std::string const& path, std::string& content) = 0;
+};
+
+/// <summary>
+/// Resolver of the files on disk, the names are relative to the directory of the file that includes them.
+/// </summary>
+class ValveDataFileResolver : public ValveDataResolver
+{
+    std::string _BaseDirectory;
+
+public:
+    // base_directory is used for the documents that are not files.
+    ValveDataFileResolver(std::string base_directory = std::string()) :
+        _BaseDirectory(std::move(base_directory))
+    {}
+
+    virtual std::string Resolve(std::string const& from, std::string const& name)
+    {
+        if (name.empty() || name[0] == '/' || name[0] == '\\' || (name.length() > 1 && name[1] == ':'))
+            return name;
+
+        std::string directory;
+        if (from.empty())
+        {
+            directory = _BaseDirectory;
+        }
+        else
+        {
+            size_t separator = from.find_last_of("/\\");
+            if (separator != std::string::npos)
+                directory = from.substr(0, separator + 1);
+        }
+
+        if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+            directory += '/';
+
+        return directory + name;
+    }
+
+    virtual bool Stat(std::string const& path, int64_t& mtime)
+    {
+#if defined(_WIN32)
+        struct _stat64 info;
+        if (_stat64(path.c_str(), &info) != 0)
+            return false;
+#else
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0)
+            return false;
+#endif
+        mtime = (int64_t)info.st_mtime;
+        return true;
+    }
+
+    virtual bool Read(std::string const& path, std::string& content)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file)
+            return false;
+
+        content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return !file.bad();
+    }
+};
+
+/// <summary>
+/// Included files that were already parsed with their own directives applied, keyed by path and by the parse options
+/// that change them. A file is parsed again when it, or a file it includes, has another modification time.
+/// It can be shared by any number of parses, on any threads: a file included by many documents is only parsed once.
+/// </summary>
+class ValveDataIncludeCache
+{
+    struct Entry
+    {
+        int64_t mtime;
+        std::shared_ptr<const ValveDataObject> fragment;
+        // The files included by the fragment, at any depth.
+        std::vector<Details::IncludeDependency> dependencies;
+    };
+
+    mutable std::mutex _Mutex;
+    std::map<std::string, Entry> _Entries;
+
+    static std::string _Key(std::string const& path, ParseOptions const& options)
+    {
+        std::string key = path;
+        key += '\0';
+        key += (char)('0' + (options.escape_sequences ? 1 : 0) + (options.infer_types ? 2 : 0) + (options.validate_utf8 ? 4 : 0) + (options.defines != nullptr ? 8 : 0));
+        key += std::to_string(options.max_depth);
+        if (options.defines != nullptr)
+        {
+            for (auto const& define : *options.defines)
+            {
+                key += '\0';
+                key += define;
+            }
+        }
+        return key;
+    }
+
+public:
+    // Returns null when the file isn't cached for these options, or it or one of the files it includes was modified since.
+    // The included files are stated with options.resolver and appended to dependencies.
+    inline std::shared_ptr<const ValveDataObject> Find(std::string const& path, int64_t mtime, ParseOptions const& options, std::vector<Details::IncludeDependency>& dependencies) const
+    {
+        Entry entry;
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            auto it = _Entries.find(_Key(path, options));
+            if (it == _Entries.end() || it->second.mtime != mtime)
+                return std::shared_ptr<const ValveDataObject>();
+
+            entry = it->second;
+        }
+
+        // The resolver may be slow, it isn't called under the lock.
+        for (auto const& dependency : entry.dependencies)
+        {
+            int64_t dependency_mtime;
+            if (!options.resolver->Stat(dependency.path, dependency_mtime) || dependency_mtime != dependency.mtime)
+                return std::shared_ptr<const ValveDataObject>();
+        }
+
+        dependencies.insert(dependencies.end(), entry.dependencies.begin(), entry.dependencies.end());
+        return entry.fragment;
+    }
+
+    inline void Insert(std::string const& path, int64_t mtime, ParseOptions const& options, std::shared_ptr<const ValveDataObject> fragment, std::vector<Details::IncludeDependency> dependencies)
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        Entry& entry = _Entries[_Key(path, options)];
+        entry.mtime = mtime;
+        entry.fragment = std::move(fragment);
+        entry.dependencies = std::move(dependencies);
+    }
+
+    inline void Clear()
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _Entries.clear();
+    }
+
+    inline size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        return _Entries.size();
+    }
+};
+
+namespace Details {
+
+/// <summary>
+/// Collects the errors of a VDF that is in memory, with their line and column.
+/// </summary>
+class DiagnosticCollector
+{
+    std::vector<ParseDiagnostic>& _Diagnostics;
+    const char* _Data;
+    size_t _Size;
+    // Line count cache, the errors mostly come in order.
+    size_t _LineOffset;
+    uint32_t _Line;
+
+public:
+    DiagnosticCollector(std::vector<ParseDiagnostic>& diagnostics, const char* data, size_t size) :
+        _Diagnostics(diagnostics),
+        _Data(data),
+        _Size(size),
+        _LineOffset(0),
+        _Line(1)
+    {}
+
+    inline void Add(ParseDiagnostic::Kind kind, size_t offset, std::string message)
+    {
+        if (offset > _Size)
+            offset = _Size;
+
+        if (offset < _LineOffset)
+        {
+            _LineOffset = 0;
+            _Line = 1;
+        }
+        // Same end of lines as the scanner: \r, or \n without \r before it.
+        for (; _LineOffset != offset; ++_LineOffset)
+        {
+            if (_Data[_LineOffset] == '\r' || (_Data[_LineOffset] == '\n' && (_LineOffset == 0 || _Data[_LineOffset - 1] != '\r')))
+                ++_Line;
+        }
+
+        size_t line_start = offset;
+        while (line_start != 0 && _Data[line_start - 1] != '\n' && _Data[line_start - 1] != '\r')
+            --line_start;
+
+        _Diagnostics.push_back(ParseDiagnostic{ kind, _Line, (uint32_t)(offset - line_start + 1), offset, std::move(message) });
+    }
+
+    // at is in the input, nullptr for its end.
+    inline void Add(ParseDiagnostic::Kind kind, const char* at, std::string message)
+    {
+        Add(kind, at == nullptr ? _Size : (size_t)(at - _Data), std::move(message));
+    }
+};
+
+/// <summary>
+/// Adds a diagnostic for each invalid UTF-8 sequence, the check starts again after the bytes that continue it.
+/// </summary>
+inline void CollectUtf8Errors(const char* data, size_t size, DiagnosticCollector& diagnostics)
+{
+    size_t offset = 0;
+    while (offset != size)
+    {
+        Utf8Validator validator;
+        size_t invalid = offset + validator.Check(data + offset, size - offset);
+        if (invalid == size && validator.Complete())
+            return;
+
+        // Report the first byte of the broken sequence, the end of the input can be in it.
+        size_t start = invalid;
+        for (size_t back = 1; back <= 3 && invalid - offset >= back; ++back)
+        {
+            unsigned char c = (unsigned char)data[invalid - back];
+            if (c < 0x80)
+                break;
+
+            if (c >= 0xc0)
+            {
+                if (back < (c >= 0xf0 ? 4u : c >= 0xe0 ? 3u : 2u))
+                    start = invalid - back;
+
+                break;
+            }
+        }
+        diagnostics.Add(ParseDiagnostic::Kind::InvalidUtf8, start, "Invalid UTF-8");
+        if (invalid == size)
+            return;
+
+        offset = invalid > start ? invalid : invalid + 1;
+        while (offset != size && ((unsigned char)data[offset] & 0xc0) == 0x80)
+            ++offset;
+    }
+}
+
+/// <summary>
+/// Reports an error of a text VDF: throws it when there are no diagnostics, else collects it and the caller recovers.
+/// token_start is the one of token, the error position.
+/// </summary>
+template<typename TextSource>
+inline void TextError(TextSource const& source, DiagnosticCollector* diagnostics, ParseDiagnostic::Kind kind, TextToken token, const char* token_start, std::string message)
+{
+    if (diagnostics == nullptr)
+        throw ParserException(message + " at line " + std::to_string(source.Line()));
+
+    if (token == TextToken::End)
+        token_start = nullptr;
+    else if (token == TextToken::String || token == TextToken::UnterminatedString)
+        --token_start; // The opening quote
+
+    diagnostics->Add(kind, token_start, std::move(message));
+}
+
+// Value of a [$CONDITION] token, a malformed condition is reported and taken as true.
+template<typename TextSource>
+inline bool TextCondition(TextSource const& source, DiagnosticCollector* diagnostics, std::vector<std::string> const& defines, const char* token_start, const char* token_end)
+{
+    StringView condition(token_start, token_end - token_start);
+    bool value;
+    if (EvaluateCondition(condition, defines, value))
+        return value;
+
+    TextError(source, diagnostics, ParseDiagnostic::Kind::InvalidCondition, TextToken::Data, token_start, "Invalid condition " + condition.str());
+    return true;
+}
+
+/// <summary>
+/// Parses the members of the opened objects and reports them to the handler, until all of them are closed or the input ends.
+/// depth is the number of opened objects, it is updated.
+/// With diagnostics, the errors are collected and the parse recovers: objects without key or over the depth limit are skipped,
+/// and an object end in place of a value closes the object.
+/// </summary>
+template<typename TextSource, typename Handler>
+inline void ParseTextMembers(TextSource& source, ParseOptions const& options, Handler& handler, uint32_t& depth, DiagnosticCollector* diagnostics = nullptr)
+{
+    const char* token_start;
+    const char* token_end;
+    TextToken token;
+
+    std::string key_buffer;
+    std::string value_buffer;
+    StringView key;
+    StringView value;
+    // The token after a value was read to look for its condition
+    bool peeked = false;
+    bool accepted = true;
+
+    for (;;)
+    {
+        if (!peeked)
+            token = source.Next(token_start, token_end);
+
+        peeked = false;
+        if (token == TextToken::End)
+            return;
+
+        if (token == TextToken::ObjectEnd)
+        {
+            handler.OnObjectEnd();
+            if (--depth == 0)
+                return;
+
+            continue;
+        }
+
+        if (token == TextToken::UnterminatedString)
+        {
+            TextError(source, diagnostics, ParseDiagnostic::Kind::UnterminatedString, token, token_start, "Expected item key end");
+            return;
+        }
+        if (token != TextToken::String && token != TextToken::Data)
+        {// Object without key
+            TextError(source, diagnostics, ParseDiagnostic::Kind::ExpectedKey, token, token_start, "Expected item key start");
+            if (!source.SkipObject())
+                return;
+
+            continue;
+        }
+        // The key must survive the read of the value.
+        key = ReadTokenString(source, token_start, token_end, options.escape_sequences, !TextSource::stable_tokens, key_buffer);
+
+        token = source.Next(token_start, token_end);
+        if (options.defines != nullptr)
+        {
+            accepted = true;
+            if (IsConditionToken(token, token_start, token_end))
+            {
+                accepted = TextCondition(source, diagnostics, *options.defines, token_start, token_end);
+                token = source.Next(token_start, token_end);
+            }
+        }
+        if (token == TextToken::End)
+        {
+            if (diagnostics != nullptr)
+                TextError(source, diagnostics, ParseDiagnostic::Kind::ExpectedValue, token, token_start, "Expected item value start");
+
+            return;
+        }
+
+        switch (token)
+        {
+            case TextToken::String:
+            case TextToken::Data:
+                if (options.defines == nullptr)
+                {
+                    handler.OnValue(key, TextValue(ReadTokenString(source, token_start, token_end, options.escape_sequences, false, value_buffer), options));
+                    break;
+                }
+
+                // The value must survive the read of the condition that can follow it.
+                value = ReadTokenString(source, token_start, token_end, options.escape_sequences, !TextSource::stable_tokens, value_buffer);
+                token = source.Next(token_start, token_end);
+                if (IsConditionToken(token, token_start, token_end))
+                {
+                    accepted = TextCondition(source, diagnostics, *options.defines, token_start, token_end) && accepted;
+                }
+                else
+                {
+                    peeked = true;
+                }
+
+                if (accepted)
+                    handler.OnValue(key, TextValue(value, options));
+
+                break;
+
+            case TextToken::ObjectStart:
+                if (!accepted)
+                {// Skip the subtree without parsing it
+                    if (!source.SkipObject())
+                        return;
+
+                    break;
+                }
+                if (depth >= options.max_depth)
+                {
+                    TextError(source, diagnostics, ParseDiagnostic::Kind::MaxDepthExceeded, token, token_start, "Maximum nesting depth of " + std::to_string(options.max_depth) + " exceeded");
+                    if (!source.SkipObject())
+                        return;
+
+                    break;
+                }
+                handler.OnObjectBegin(key);
+                ++depth;
+                break;
+
+            case TextToken::UnterminatedString:
+                TextError(source, diagnostics, ParseDiagnostic::Kind::UnterminatedString, token, token_start, "Expected item value end");
+                return;
+
+            default:
+                // Object end without value
+                TextError(source, diagnostics, ParseDiagnostic::Kind::ExpectedValue, token, token_start, "Expected item value start");
+                handler.OnObjectEnd();
+                if (--depth == 0)
+                    return;
+
+                break;
+        }
+    }
+}
+
+/// <summary>
+/// Parses a text VDF from the source and reports it to the handler.
+/// When directives is set, the #base and #include directives before the root key are added to it.
+/// With diagnostics, the errors are collected and the parse recovers from them, see ParseTextMembers.
+/// </summary>
+template<typename TextSource, typename Handler>
+inline void ParseText(TextSource& source, ParseOptions const& options, Handler& handler, std::vector<TextDirective>* directives = nullptr, DiagnosticCollector* diagnostics = nullptr)
+{
+    const char* token_start;
+    const char* token_end;
+    TextToken token;
+
+    std::string key_buffer;
+    StringView key;
+
+    for (;;)
+    {
+        token = source.Next(token_start, token_end);
+        if (token == TextToken::End)
+            return;
+
+        if (token == TextToken::UnterminatedString)
+        {
+            TextError(source, diagnostics, ParseDiagnostic::Kind::UnterminatedString, token, token_start, "Expected object key end");
+            return;
+        }
+        if (token != TextToken::String && token != TextToken::Data)
+        {
+            TextError(source, diagnostics, ParseDiagnostic::Kind::ExpectedKey, token, token_start, "Expected object key start");
+            // Root object without key, or a stray object end
+            if (token == TextToken::ObjectStart)
+                break;
+
+            continue;
+        }
+
+        // Directives are unquoted
+        StringView name(token_start, token_end - token_start);
+        if (directives == nullptr || token != TextToken::Data || (name != "#base" && name != "#include"))
+            break;
+
+        DirectiveType type = name == "#base" ? DirectiveType::Base : DirectiveType::Include;
+        token = source.Next(token_start, token_end);
+        if (token != TextToken::String && token != TextToken::Data)
+        {
+            TextError(source, diagnostics, ParseDiagnostic::Kind::InvalidDirective, token, token_start, "Expected directive path");
+            continue;
+        }
+        directives->push_back(TextDirective{ type, ReadTokenString(source, token_start, token_end, options.escape_sequences, true, key_buffer).str() });
+    }
+
+    if (token != TextToken::ObjectStart)
+    {
+        key = ReadTokenString(source, token_start, token_end, options.escape_sequences, !TextSource::stable_tokens, key_buffer);
+
+        token = source.Next(token_start, token_end);
+        if (token != TextToken::ObjectStart)
+        {
+            TextError(source, diagnostics, ParseDiagnostic::Kind::ExpectedObjectStart, token, token_start, "Expected object start");
+            return;
+        }
+    }
+
+    uint32_t depth = 1;
+    handler.OnObjectBegin(key);
+    ParseTextMembers(source, options, handler, depth, diagnostics);
+
+    if (diagnostics != nullptr)
+    {
+        if (depth != 0)
+        {
+            TextError(source, diagnostics, ParseDiagnostic::Kind::UnclosedObject, TextToken::End, nullptr, "Expected object end");
+        }
+        else
+        {
+            token = source.Next(token_start, token_end);
+            if (token != TextToken::End)
+                TextError(source, diagnostics, ParseDiagnostic::Kind::TrailingData, token, token_start, "Unexpected data after the root object");
+        }
+    }
+
+    // Premature end of file, close the opened objects.
+    while (depth-- != 0)
+        handler.OnObjectEnd();
+}
+
+// CRC-32 (IEEE 802.3) tables of the slicing-by-8 algorithm: table[n][i] is the CRC of byte i followed by n null bytes.
+struct Crc32Tables
+{
+    uint32_t table[8][256];
+
+    Crc32Tables()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc & 1) != 0 ? 0xedb88320 ^ (crc >> 1) : crc >> 1;
+
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            for (int n = 1; n < 8; ++n)
+                table[n][i] = (table[n - 1][i] >> 8) ^ table[0][table[n - 1][i] & 0xff];
+        }
+    }
+};
+
+// Updates the CRC-32 of the previous bytes (0 for none) with the next ones, 8 bytes at a time.
+inline uint32_t Crc32(uint32_t crc, const char* data, size_t size)
+{
+    static const Crc32Tables tables;
+    auto const& table = tables.table;
+
+    crc = ~crc;
+    for (; size >= 8; data += 8, size -= 8)
+    {
+        uint32_t low, high;
+        memcpy(&low, data, sizeof(low));
+        memcpy(&high, data + 4, sizeof(high));
+        low ^= crc;
+        crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^ table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+              table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^ table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+    }
+    for (; size != 0; ++data, --size)
+        crc = table[0][(crc ^ (uint8_t)*data) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+inline void CheckBinaryCrc(uint32_t crc, uint32_t expected)
+{
+    if (crc != expected)
+    {
+        throw ParserException("CRC mismatch of binary VDF");
+    }
+}
+
+/// <summary>
+/// Binary VDF parser that keeps its state between the chunks of input, and reports the items to the handler.
+/// </summary>
+class BinaryParser
+{
+    enum class Step : uint8_t
+    {
+        RootType,
+        RootName,
+        Type,
+        Key,
+        Value,
+        Done,
+    };
+
+    ParseOptions _Options;
+    BinaryNodeType _ObjectEnd;
+    Step _Step;
+    BinaryNodeType _Type;
+    uint32_t _Depth;
+    std::string _Key;
+    // Value being read, strings and the bytes of the other types.
+    std::string _Value;
+    // UTF-8 form of a wide string.
+    std::string _Text;
+
+    template<typename Handler, typename T>
+    inline bool _ReadScalar(const char*& b, const char* e, Handler& handler)
+    {
+        ReadBinaryBytes(b, e, _Value, sizeof(T));
+        if (_Value.length() != sizeof(T))
+            return false;
+
+        T value;
+        memcpy(&value, _Value.data(), sizeof(value));
+        handler.OnValue(StringView(_Key), ValveDataValue(value));
+        return true;
+    }
+
+public:
+    BinaryParser(BinaryNodeType object_end, ParseOptions const& options) :
+        _Options(options),
+        _ObjectEnd(object_end),
+        _Step(Step::RootType),
+        _Type(BinaryNodeType::Object),
+        _Depth(0)
+    {}
+
+    // Parses the chunk, returns true once the root object is closed (b is then right after it).
+    template<typename Handler>
+    bool Parse(const char*& b, const char* e, Handler& handler)
+    {
+        while (b != e)
+        {
+            switch (_Step)
+            {
+                case Step::RootType:
+                    if (*b++ != (int8_t)BinaryNodeType::Object)
+                    {
+                        throw ParserException("Binary root item type is not an object");
+                    }
+                    _Key.clear();
+                    _Step = Step::RootName;
+                    break;
+
+                case Step::RootName:
+                    if (ParseBinaryString(b, e, _Key) == 0)
+                    {
+                        if (_Options.validate_utf8)
+                            CheckBinaryString(_Key);
+
+                        handler.OnObjectBegin(StringView(_Key));
+                        _Depth = 1;
+                        _Step = Step::Type;
+                    }
+                    break;
+
+                case Step::Type:
+                    _Type = (BinaryNodeType)*b++;
+                    _Key.clear();
+                    if (_Type == BinaryNodeType::ObjectEnd || _Type == BinaryNodeType::AlternativeEnd)
+                    {
+                        if (_Type != _ObjectEnd)
+                        {
+                            // Got object end but I didn't expected this value
+                            //SPDLOG_DEBUG("Got object end {:02x} but expected {:02x}", (uint32_t)_Type, (uint32_t)_ObjectEnd);
+                        }
+
+                        handler.OnObjectEnd();
+                        if (--_Depth == 0)
+                        {
+                            _Step = Step::Done;
+                            return true;
+                        }
+                    }
+                    else
+                    {
+                        _Step = Step::Key;
+                    }
+                    break;
+
+                case Step::Key:
+                    if (ParseBinaryString(b, e, _Key) == 0)
+                    {
+                        if (_Options.validate_utf8)
+                            CheckBinaryString(_Key);
+
+                        _Value.clear();
+                        _Step = Step::Value;
+                    }
+                    break;
+
+                case Step::Value:
+                {
+                    bool done = false;
+
+                    switch (_Type)
+                    {
+                        case BinaryNodeType::Object:
+                            if (_Depth >= _Options.max_depth)
+                            {
+                                throw ParserException("Maximum nesting depth of " + std::to_string(_Options.max_depth) + " exceeded");
+                            }
+                            handler.OnObjectBegin(StringView(_Key));
+                            ++_Depth;
+                            done = true;
+                            break;
+
+                        case BinaryNodeType::String:
+                            if (ParseBinaryString(b, e, _Value) == 0)
+                            {// String was fully read
+                                if (_Options.validate_utf8)
+                                    CheckBinaryString(_Value);
+
+                                handler.OnValue(StringView(_Key), ValveDataValue(StringView(_Value)));
+                                done = true;
+                            }
+                            break;
+
+                        case BinaryNodeType::WideString:
+                            if (ParseBinaryWideString(b, e, _Value) == 0)
+                            {
+                                DecodeBinaryWideString(_Value.data(), _Value.length(), _Text);
+                                handler.OnValue(StringView(_Key), ValveDataValue(ObjectType::WideString, StringView(_Text)));
+                                done = true;
+                            }
+                            break;
+
+                        case BinaryNodeType::Binary:
+                        {// Size, then the bytes
+                            uint32_t size = 0;
+                            if (_Value.length() < sizeof(size))
+                                ReadBinaryBytes(b, e, _Value, sizeof(size));
+
+                            if (_Value.length() < sizeof(size))
+                                break;
+
+                            memcpy(&size, _Value.data(), sizeof(size));
+                            ReadBinaryBytes(b, e, _Value, sizeof(size) + (size_t)size);
+                            if (_Value.length() == sizeof(size) + (size_t)size)
+                            {
+                                handler.OnValue(StringView(_Key), ValveDataValue(ObjectType::Binary, StringView(_Value.data() + sizeof(size), size)));
+                                done = true;
+                            }
+                            break;
+                        }
+
+                        case BinaryNodeType::Int32  : done = _ReadScalar<Handler, int32_t>(b, e, handler); break;
+                        case BinaryNodeType::Float  : done = _ReadScalar<Handler, float>(b, e, handler); break;
+                        case BinaryNodeType::Pointer: done = _ReadScalar<Handler, pointer_t>(b, e, handler); break;
+                        case BinaryNodeType::Color  : done = _ReadScalar<Handler, color_t>(b, e, handler); break;
+                        case BinaryNodeType::Int64  : done = _ReadScalar<Handler, int64_t>(b, e, handler); break;
+                        case BinaryNodeType::UInt64 : done = _ReadScalar<Handler, uint64_t>(b, e, handler); break;
+
+                        default:
+                            //SPDLOG_DEBUG("Unhandled item type {:02x}", (uint32_t)_Type);
+                            throw ParserException("Unhandled binary item type " + std::to_string((uint32_t)_Type));
+                    }
+
+                    if (done)
+                        _Step = Step::Type;
+
+                    break;
+                }
+
+                case Step::Done:
+                    return true;
+            }
+        }
+
+        return _Step == Step::Done;
+    }
+
+    // End of the input: closes the opened objects.
+    template<typename Handler>
+    void Finish(Handler& handler)
+    {
+        if (_Step == Step::RootType)
+        {
+            throw ParserException("Premature end of file while parsing root binary object");
+        }
+        if (_Step == Step::RootName || _Step == Step::Done)
+            return;
+
+        // Premature end of file, close the opened objects.
+        while (_Depth != 0)
+        {
+            --_Depth;
+            handler.OnObjectEnd();
+        }
+        _Step = Step::Done;
+    }
+};
+
+/// <summary>
+/// Parses a binary VDF and reports it to the handler, the chunks are read until the root object ends.
+/// When crc is set, it is updated with the parsed bytes of each chunk.
+/// </summary>
+template<typename ChunkReader, typename Handler>
+inline void ParseBinary(ChunkReader& reader, BinaryNodeType object_end, ParseOptions const& options, const char*& buffer_start, const char*& buffer_end, Handler& handler, uint32_t* crc = nullptr)
+{
+    BinaryParser parser(object_end, options);
+
+    do
+    {
+        const char* chunk_start = buffer_start;
+        bool done = parser.Parse(buffer_start, buffer_end, handler);
+        if (crc != nullptr)
+            *crc = Crc32(*crc, chunk_start, buffer_start - chunk_start);
+
+        if (done)
+            return;
+    }
+    while (reader.Read(buffer_start, buffer_end));
+
+    parser.Finish(handler);
+}
+
+// Reads a fixed size value of a binary VDF in memory, returns false on premature end of input.
+template<typename T, typename Handler>
+inline bool ReadBinaryScalar(const char*& b, const char* e, StringView key, Handler& handler)
+{
+    if ((size_t)(e - b) < sizeof(T))
+        return false;
+
+    T value;
+    memcpy(&value, b, sizeof(value));
+    b += sizeof(T);
+    handler.OnValue(key, ValveDataValue(value));
+    return true;
+}
+
+// Reads a null terminated string of a binary VDF in memory, str points into the input.
+// Returns false on premature end of input.
+inline bool ReadBinaryString(const char*& b, const char* e, bool validate_utf8, StringView& str)
+{
+    const char* string_end = static_cast<const char*>(memchr(b, '\0', e - b));
+    if (string_end == nullptr)
+        return false;
+
+    str = StringView(b, string_end - b);
+    if (validate_utf8)
+        CheckBinaryString(str);
+
+    b = string_end + 1;
+    return true;
+}
+
+// Reads a null terminated UTF-16 string of a binary VDF in memory, str is its UTF-8 form stored in buffer.
+// Returns false on premature end of input.
+inline bool ReadBinaryWideString(const char*& b, const char* e, std::string& buffer, StringView& str)
+{
+    const char* string_end = FindWideStringEnd(b, e);
+    if (string_end == nullptr)
+        return false;
+
+    DecodeBinaryWideString(b, string_end - b, buffer);
+    str = StringView(buffer);
+    b = string_end + 2;
+    return true;
+}
+
+// Reads the size and the bytes of a binary blob of a binary VDF in memory, bytes points into the input.
+// Returns false on premature end of input.
+inline bool ReadBinaryBlob(const char*& b, const char* e, StringView& bytes)
+{
+    uint32_t size;
+    if ((size_t)(e - b) < sizeof(size))
+        return false;
+
+    memcpy(&size, b, sizeof(size));
+    if ((size_t)(e - b) - sizeof(size) < size)
+        return false;
+
+    bytes = StringView(b + sizeof(size), size);
+    b += sizeof(size) + (size_t)size;
+    return true;
+}
+
+// Keys of a binary VDF, stored as null terminated strings before their value.
+struct BinaryInlineKeys
+{
+    inline bool Read(const char*& b, const char* e, bool validate_utf8, StringView& key) const
+    {
+        return ReadBinaryString(b, e, validate_utf8, key);
+    }
+};
+
+// Keys of the binary VDF of appinfo.vdf v29: indexes into the string table of the file.
+struct BinaryKeyTable
+{
+    std::vector<StringView> keys;
+
+    inline bool Read(const char*& b, const char* e, bool validate_utf8, StringView& key) const
+    {
+        uint32_t index;
+        if (e - b < (ptrdiff_t)sizeof(index))
+            return false;
+
+        memcpy(&index, b, sizeof(index));
+        b += sizeof(index);
+        if (index >= keys.size())
+        {
+            throw ParserException("Invalid key index " + std::to_string(index));
+        }
+        key = keys[index];
+        if (validate_utf8)
+            CheckBinaryString(key);
+
+        return true;
+    }
+};
+
+// Moves b after the binary VDF that starts there, returns false when it is truncated or malformed.
+inline bool SkipBinaryDocument(const char*& b, const char* e)
+{
+    StringView str;
+    if (b == e || *b++ != (int8_t)BinaryNodeType::Object || !ReadBinaryString(b, e, false, str))
+        return false;
+
+    uint32_t depth = 1;
+    while (b != e)
+    {
+        BinaryNodeType type = (BinaryNodeType)*b++;
+        if (type == BinaryNodeType::ObjectEnd || type == BinaryNodeType::AlternativeEnd)
+        {
+            if (--depth == 0)
+                return true;
+
+            continue;
+        }
+        if (!ReadBinaryString(b, e, false, str))
+            return false;
+
+        size_t value_size = 0;
+        switch (type)
+        {
+            case BinaryNodeType::Object : ++depth; break;
+            case BinaryNodeType::String : if (!ReadBinaryString(b, e, false, str)) return false; break;
+            case BinaryNodeType::Binary : if (!ReadBinaryBlob(b, e, str)) return false; break;
+            case BinaryNodeType::WideString:
+            {
+                const char* string_end = FindWideStringEnd(b, e);
+                if (string_end == nullptr)
+                    return false;
+
+                b = string_end + 2;
+                break;
+            }
+            case BinaryNodeType::Int32  :
+            case BinaryNodeType::Float  :
+            case BinaryNodeType::Pointer:
+            case BinaryNodeType::Color  : value_size = 4; break;
+            case BinaryNodeType::Int64  :
+            case BinaryNodeType::UInt64 : value_size = 8; break;
+            default: return false;
+        }
+        if ((size_t)(e - b) < value_size)
+            return false;
+
+        b += value_size;
+    }
+
+    return false;
+}
+
+/// <summary>
+/// Parses the items of the opened objects of a binary VDF that is fully in memory, until all of them are closed or the input ends.
+/// depth is the number of opened objects, it is updated. The keys and strings point into the input.
+/// </summary>
+template<typename Handler, typename Keys = BinaryInlineKeys>
+inline void ParseBinaryMembers(const char*& b, const char* e, ParseOptions const& options, Handler& handler, uint32_t& depth, Keys const& keys = Keys())
+{
+    StringView key;
+    StringView value;
+    // UTF-8 form of the wide strings.
+    std::string text;
+
+    while (b != e)
+    {
+        BinaryNodeType type = (BinaryNodeType)*b++;
+        if (type == BinaryNodeType::ObjectEnd || type == BinaryNodeType::AlternativeEnd)
+        {
+            handler.OnObjectEnd();
+            if (--depth == 0)
+                return;
+
+            continue;
+        }
+
+        // Like ParseBinary, the value starts with the next byte, even for objects.
+        if (!keys.Read(b, e, options.validate_utf8, key) || b == e)
+            break;
+
+        bool read = true;
+        switch (type)
+        {
+            case BinaryNodeType::Object:
+                if (depth >= options.max_depth)
+                {
+                    throw ParserException("Maximum nesting depth of " + std::to_string(options.max_depth) + " exceeded");
+                }
+                handler.OnObjectBegin(key);
+                ++depth;
+                break;
+
+            case BinaryNodeType::String:
+                read = ReadBinaryString(b, e, options.validate_utf8, value);
+                if (read)
+                    handler.OnValue(key, ValveDataValue(value));
+
+                break;
+
+            case BinaryNodeType::WideString:
+                read = ReadBinaryWideString(b, e, text, value);
+                if (read)
+                    handler.OnValue(key, ValveDataValue(ObjectType::WideString, value));
+
+                break;
+
+            case BinaryNodeType::Binary:
+                read = ReadBinaryBlob(b, e, value);
+                if (read)
+                    handler.OnValue(key, ValveDataValue(ObjectType::Binary, value));
+
+                break;
+
+            case BinaryNodeType::Int32  : read = ReadBinaryScalar<int32_t>(b, e, key, handler); break;
+            case BinaryNodeType::Float  : read = ReadBinaryScalar<float>(b, e, key, handler); break;
+            case BinaryNodeType::Pointer: read = ReadBinaryScalar<pointer_t>(b, e, key, handler); break;
+            case BinaryNodeType::Color  : read = ReadBinaryScalar<color_t>(b, e, key, handler); break;
+            case BinaryNodeType::Int64  : read = ReadBinaryScalar<int64_t>(b, e, key, handler); break;
+            case BinaryNodeType::UInt64 : read = ReadBinaryScalar<uint64_t>(b, e, key, handler); break;
+
+            default:
+                throw ParserException("Unhandled binary item type " + std::to_string((uint32_t)type));
+        }
+
+        if (!read)
+            break;
+    }
+
+    b = e;
+}
+
+/// <summary>
+/// Parses a binary VDF that is fully in memory and reports it to the handler, the keys and strings point into the input.
+/// Same items as ParseBinary without its state machine, b is left right after the root object.
+/// </summary>
+template<typename Handler, typename Keys = BinaryInlineKeys>
+inline void ParseBinaryBuffer(const char*& b, const char* e, ParseOptions const& options, Handler& handler, Keys const& keys = Keys())
+{
+    if (b == e)
+    {
+        throw ParserException("Premature end of file while parsing root binary object");
+    }
+    if (*b++ != (int8_t)BinaryNodeType::Object)
+    {
+        throw ParserException("Binary root item type is not an object");
+    }
+
+    StringView key;
+    if (!keys.Read(b, e, options.validate_utf8, key))
+    {
+        b = e;
+        return;
+    }
+
+    handler.OnObjectBegin(key);
+    uint32_t depth = 1;
+    ParseBinaryMembers(b, e, options, handler, depth, keys);
+
+    // Premature end of file, close the opened objects.
+    while (depth-- != 0)
+        handler.OnObjectEnd();
+}
+
+/// <summary>
+/// Pull access to the bytes of a binary VDF, in memory or read by chunks from a stream.
+/// </summary>
+class BinaryInput
+{
+    std::istream* _Is;
+    std::string _Buffer;
+    const char* _Start;
+    const char* _End;
+    bool _ValidateUtf8;
+
+    inline bool _Fill()
+    {
+        if (_Is == nullptr)
+            return false;
+
+        _Is->read(&_Buffer[0], _Buffer.length());
+        _Start = _Buffer.data();
+        _End = _Start + _Is->gcount();
+        return _Start != _End;
+    }
+
+public:
+    BinaryInput(const char* data, size_t size, bool validate_utf8 = false) :
+        _Is(nullptr),
+        _Start(data),
+        _End(data + size),
+        _ValidateUtf8(validate_utf8)
+    {}
+
+    // The lookahead bytes were already read from the stream, they come first.
+    BinaryInput(std::istream& is, size_t chunk_size, bool validate_utf8 = false, StringView lookahead = StringView()) :
+        _Is(&is),
+        _Buffer(chunk_size < lookahead.size() ? lookahead.size() : (chunk_size == 0 ? 1 : chunk_size), '\0'),
+        _ValidateUtf8(validate_utf8)
+    {
+        memcpy(&_Buffer[0], lookahead.data(), lookahead.size());
+        _Start = _Buffer.data();
+        _End = _Start + lookahead.size();
+    }
+
+    // Returns false on premature end of input.
+    inline bool Read(void* dst, size_t count)
+    {
+        char* out = static_cast<char*>(dst);
+        while ((size_t)(_End - _Start) < count)
+        {
+            size_t available = _End - _Start;
+            if (available != 0)
+                memcpy(out, _Start, available);
+
+            out += available;
+            count -= available;
+            if (!_Fill())
+                return false;
+        }
+        memcpy(out, _Start, count);
+        _Start += count;
+        return true;
+    }
+
+    // Reads a null terminated string, returns false on premature end of input.
+    inline bool ReadString(std::string& str)
+    {
+        str.clear();
+        for (;;)
+        {
+            if (_Start != _End && ParseBinaryString(_Start, _End, str) == 0)
+            {
+                if (_ValidateUtf8)
+                    CheckBinaryString(str);
+
+                return true;
+            }
+
+            if (!_Fill())
+                return false;
+        }
+    }
+
+    // Reads a null terminated UTF-16 string as UTF-8, units is the buffer of its code units.
+    // Returns false on premature end of input.
+    inline bool ReadWideString(std::string& str, std::string& units)
+    {
+        units.clear();
+        for (;;)
+        {
+            if (_Start != _End && ParseBinaryWideString(_Start, _End, units) == 0)
+            {
+                DecodeBinaryWideString(units.data(), units.length(), str);
+                return true;
+            }
+
+            if (!_Fill())
+                return false;
+        }
+    }
+
+    // Reads count bytes, returns false on premature end of input.
+    inline bool ReadBytes(std::string& bytes, size_t count)
+    {
+        bytes.clear();
+        for (;;)
+        {
+            ReadBinaryBytes(_Start, _End, bytes, count);
+            if (bytes.length() == count)
+                return true;
+
+            if (!_Fill())
+                return false;
+        }
+    }
+};
+
+struct ViewNode
+{
+    StringView name;
+    // None for objects.
+    ValveDataValue value;
+    // Number of nodes of the subtree, itself included: the next sibling is at this + span.
+    uint32_t span;
+    // Number of children.
+    uint32_t size;
+    ObjectType type;
+};
+
+/// <summary>
+/// Builds a ValveDataView, the strings inside the input are referenced, the others are copied to the view.
+/// </summary>
+class ViewBuilder
+{
+    ValveDataView& _View;
+    const char* _InputStart;
+    const char* _InputEnd;
+    std::vector<uint32_t> _Stack;
+    char* _Block;
+    size_t _BlockLeft;
+
+    inline StringView _Store(StringView str);
+
+    inline ViewNode& _AddNode(StringView key, ObjectType type);
+
+public:
+    inline ViewBuilder(ValveDataView& view, const char* input, size_t size);
+
+    inline void OnObjectBegin(StringView key);
+
+    inline void OnObjectEnd();
+
+    inline void OnValue(StringView key, ValveDataValue const& value);
+};
+
+}
+
+namespace Details {
+
+// Reads the header of the stream and returns whether it is a binary VDF. The stream is only read forward, so pipes
+// and sockets work: lookahead is set to the number of bytes of the document that were read into buffer to detect it.
+// crc is set to the CRC of the VBKV header, when there is one.
+inline bool DetectStreamFormat(std::istream& is, std::string& buffer, BinaryNodeType& binary_root_end, size_t& lookahead, uint32_t* crc = nullptr)
+{
+    bool as_binary = false;
+    binary_root_end = BinaryNodeType::ObjectEnd;
+
+    is.read(&buffer[0], 4);
+    lookahead = (size_t)is.gcount();
+    if (lookahead == 0)
+        throw ParserException("Failed to read stream.");
+
+    uint32_t magic;
+    memcpy(&magic, buffer.data(), sizeof(magic));
+    if (lookahead == 4 && magic == BinaryVDFMagic)
+    {
+        lookahead = 0;
+        as_binary = true;
+        binary_root_end = BinaryNodeType::AlternativeEnd;
+        is.read(&buffer[0], 4);
+        if (!is)
+            throw ParserException("Premature end of file while reading binary header");
+
+        if (crc != nullptr)
+            memcpy(crc, buffer.data(), sizeof(*crc));
+    }
+    else
+    {
+        if (buffer[0] == '\0')
+        {// Likely, This is the root object as binary
+            as_binary = true;
+        }
+    }
+
+    return as_binary;
+}
+
+// Returns whether the buffer is a binary VDF, data and size are moved past the header.
+// crc is set to the CRC of the VBKV header, when there is one.
+inline bool DetectBufferFormat(const char*& data, size_t& size, BinaryNodeType& binary_root_end, uint32_t* crc = nullptr)
+{
+    bool as_binary = false;
+    uint32_t magic;
+    binary_root_end = BinaryNodeType::ObjectEnd;
+
+    if (size == 0)
+        throw ParserException("Failed to read buffer.");
+
+    // Shorter than the magic, as DetectStreamFormat.
+    if (size >= 4 && (memcpy(&magic, data, sizeof(magic)), magic == BinaryVDFMagic))
+    {
+        if (size < 8)
+            throw ParserException("Premature end of file while reading binary header");
+
+        as_binary = true;
+        binary_root_end = BinaryNodeType::AlternativeEnd;
+        if (crc != nullptr)
+            memcpy(crc, data + 4, sizeof(*crc));
+
+        // Skip magic and crc
+        data += 8;
+        size -= 8;
+    }
+    else if (data[0] == '\0')
+    {// Likely, This is the root object as binary
+        as_binary = true;
+    }
+
+    return as_binary;
+}
+
+template<typename Handler>
+inline void ParseStream(std::istream& is, Handler& handler, ParseOptions const& options, std::vector<TextDirective>* directives)
+{
+    Details::BinaryNodeType binary_root_end;
+    size_t lookahead;
+    uint32_t stored_crc;
+
+    // Need at least enough room for the format detection.
+    std::string buffer(options.chunk_size < 8 ? 8 : options.chunk_size, '\0');
+
+    if (!Details::DetectStreamFormat(is, buffer, binary_root_end, lookahead, &stored_crc))
+    {// Parse as text VDF
+        Details::StreamTextSource source(is, buffer, options.validate_utf8, lookahead);
+        Details::ParseText(source, options, handler, directives);
+    }
+    else
+    {// Parse as binary VDF, from the bytes read by the detection
+        const char* buffer_start = buffer.data();
+        const char* buffer_end = buffer_start + lookahead;
+        bool verify_crc = options.verify_crc && binary_root_end == BinaryNodeType::AlternativeEnd;
+        uint32_t crc = 0;
+        Details::StreamChunkReader reader(is, buffer);
+        Details::ParseBinary(reader, binary_root_end, options, buffer_start, buffer_end, handler, verify_crc ? &crc : nullptr);
+        if (verify_crc)
+            CheckBinaryCrc(crc, stored_crc);
+    }
+}
+
+template<typename Handler>
+inline void ParseBuffer(const char* data, size_t size, Handler& handler, ParseOptions const& options, std::vector<TextDirective>* directives)
+{
+    Details::BinaryNodeType binary_root_end;
+    uint32_t stored_crc;
+
+    if (!Details::DetectBufferFormat(data, size, binary_root_end, &stored_crc))
+    {// Parse as text VDF
+        Details::BufferTextSource source(data, size, 1, options.validate_utf8);
+        Details::ParseText(source, options, handler, directives);
+    }
+    else
+    {// Parse as binary VDF
+        const char* content = data;
+        Details::ParseBinaryBuffer(data, content + size, options, handler);
+        // The decoded bytes are still in the cache.
+        if (options.verify_crc && binary_root_end == BinaryNodeType::AlternativeEnd)
+            CheckBinaryCrc(Crc32(0, content, data - content), stored_crc);
+    }
+}
+
+}
+
+/// <summary>
+/// Parses a VDF (text or binary) and reports it to the handler, without building any tree.
+/// The handler is a class with the following methods, called in document order:
+///   void OnObjectBegin(StringView key);
+///   void OnObjectEnd();
+///   void OnValue(StringView key, ValveDataValue const& value);
+/// The keys and values are only valid during the call. On a premature end of input, the opened objects are closed.
+/// </summary>
+template<typename Handler>
+inline void ParseWithHandler(std::istream& is, Handler& handler, ParseOptions const& options = ParseOptions())
+{
+    Details::ParseStream(is, handler, options, nullptr);
+}
+
+/// <summary>
+/// Parses a VDF (text or binary) that is already in memory and reports it to the handler, see above.
+/// Unescaped text strings point into the buffer.
+/// </summary>
+template<typename Handler>
+inline void ParseWithHandler(const char* data, size_t size, Handler& handler, ParseOptions const& options = ParseOptions())
+{
+    Details::ParseBuffer(data, size, handler, options, nullptr);
+}
+
+/// <summary>
+/// Parse handler that builds a ValveDataObject tree, the first object is the root.
+/// </summary>
+class ValveDataObjectBuilder
+{
+    ValveDataObject& _Root;
+    // The collections are heap allocated so the pointers stay valid when their parent grows.
+    std::vector<ValveCollection*> _Stack;
+    std::string _Key;
+
+public:
+    ValveDataObjectBuilder(ValveDataObject& root) :
+        _Root(root)
+    {}
+
+    inline void OnObjectBegin(StringView key)
+    {
+        if (_Stack.empty())
+        {
+            _Root._ResetValue();
+            _Root._Obj->_Name.assign(key.data(), key.size());
+            _Root._Obj->_NameHash = std::hash<std::string>()(_Root._Obj->_Name);
+            _Root._Obj->_U._Collection = new ValveCollection();
+            _Root._Obj->_Type = ObjectType::Object;
+            _Stack.emplace_back(_Root._Obj->_U._Collection);
+            return;
+        }
+
+        ValveCollection* collection = _Stack.back();
+        _Key.assign(key.data(), key.size());
+        collection->emplace_back(_Key);
+        _Stack.emplace_back(collection->back()._Obj->_U._Collection);
+    }
+
+    inline void OnObjectEnd()
+    {
+        _Stack.pop_back();
+    }
+
+    inline void OnValue(StringView key, ValveDataValue const& value)
+    {
+        _Key.assign(key.data(), key.size());
+        AddValue(*_Stack.back(), _Key, value);
+    }
+
+    static inline void AddValue(ValveCollection& collection, std::string const& key, ValveDataValue const& value)
+    {
+        switch (value.Type())
+        {
+            case ObjectType::String : collection.emplace_back(key, value.String().str()); break;
+            case ObjectType::WideString: collection.emplace_back(key, wide_string_t{ value.WideString().str() }); break;
+            case ObjectType::Binary : collection.emplace_back(key, binary_t{ value.Binary().str() }); break;
+            case ObjectType::Int32  : collection.emplace_back(key, value.Int32()); break;
+            case ObjectType::Float  : collection.emplace_back(key, value.Float()); break;
+            case ObjectType::Pointer: collection.emplace_back(key, value.Pointer()); break;
+            case ObjectType::Color  : collection.emplace_back(key, value.Color()); break;
+            case ObjectType::Int64  : collection.emplace_back(key, value.Int64()); break;
+            case ObjectType::UInt64 : collection.emplace_back(key, value.UInt64()); break;
+            default: break; // Warning fix.
+        }
+    }
+};
+
+namespace Details {
+
+// Runs function(index) for each index of [0, count) on up to thread_count threads, the calling thread included.
+// The first exception thrown by function is rethrown once all the threads are done.
+template<typename Function>
+inline void ParallelFor(size_t count, size_t thread_count, Function const& function)
+{
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&]()
+    {
+        size_t index;
+        while ((index = next++) < count)
+        {
+            try
+            {
+                function(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count && i < count; ++i)
+    {
+        try
+        {
+            threads.emplace_back(worker);
+        }
+        catch (...)
+        {// Go on with the threads we have
+            break;
+        }
+    }
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+/// <summary>
+/// Items parsed from a range of a text VDF that starts and ends between two items, at any depth.
+/// </summary>
+struct TextFragment
+{
+    // Items of the level the range starts at, and of the levels below it once the starting objects are closed.
+    ValveCollection items;
+    // items.size() each time an object opened before the range was closed.
+    std::vector<size_t> closes;
+    // Objects opened in the range and not closed: the last item, then its last child, and so on.
+    uint32_t open_levels = 0;
+};
+
+class TextFragmentBuilder
+{
+    TextFragment& _Fragment;
+    std::vector<ValveCollection*> _Stack;
+    std::string _Key;
+
+public:
+    TextFragmentBuilder(TextFragment& fragment) :
+        _Fragment(fragment)
+    {}
+
+    inline void OnObjectBegin(StringView key)
+    {
+        ValveCollection* collection = _Stack.empty() ? &_Fragment.items : _Stack.back();
+        _Key.assign(key.data(), key.size());
+        collection->emplace_back(_Key);
+        _Stack.emplace_back(&collection->back().Collection());
+    }
+
+    inline void OnObjectEnd()
+    {
+        if (_Stack.empty())
+        {
+            _Fragment.closes.emplace_back(_Fragment.items.size());
+        }
+        else
+        {
+            _Stack.pop_back();
+        }
+    }
+
+    inline void OnValue(StringView key, ValveDataValue const& value)
+    {
+        _Key.assign(key.data(), key.size());
+        ValveDataObjectBuilder::AddValue(_Stack.empty() ? _Fragment.items : *_Stack.back(), _Key, value);
+    }
+
+    inline void Finish()
+    {
+        _Fragment.open_levels = (uint32_t)_Stack.size();
+    }
+};
+
+/// <summary>
+/// Quote and brace counts of a chunk of a text VDF, computed before the string state at its start is known.
+/// </summary>
+struct TextChunkState
+{
+    size_t start;
+    size_t end;
+    // Whether the chunk starts after an odd backslash sequence.
+    bool escaped;
+    // Whether the chunk has an odd number of unescaped quotes.
+    bool quote_parity;
+    // Opened minus closed objects, when the chunk starts outside (0) or inside (1) of a string.
+    int64_t depth_delta[2];
+    // Known once the previous chunks are counted.
+    bool in_string;
+    int64_t depth;
+};
+
+inline void CountTextChunk(const char* data, TextChunkState& chunk)
+{
+    StructuralIndexer indexer(chunk.escaped, false);
+    TextBlock block;
+    bool quote_parity = false;
+    int64_t delta_outside = 0, delta_inside = 0;
+
+    for (size_t offset = chunk.start; offset < chunk.end; offset += 64)
+    {
+        size_t left = chunk.end - offset;
+        if (left >= 64)
+        {
+            ClassifyTextBlock(data + offset, block);
+        }
+        else
+        {
+            char tail[64];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, data + offset, left);
+            ClassifyTextBlock(tail, block);
+        }
+
+        uint64_t open_brace = block.open_brace;
+        uint64_t close_brace = block.close_brace;
+        indexer.Index(block);
+
+        quote_parity ^= (PopCount64(block.quote) & 1) != 0;
+        delta_outside += (int64_t)PopCount64(block.open_brace) - PopCount64(block.close_brace);
+        delta_inside += (int64_t)PopCount64(open_brace & ~block.open_brace) - PopCount64(close_brace & ~block.close_brace);
+    }
+
+    chunk.quote_parity = quote_parity;
+    chunk.depth_delta[0] = delta_outside;
+    chunk.depth_delta[1] = delta_inside;
+}
+
+// Finds the first end of object in the chunk that leaves at least one object opened, returns false if there is none.
+inline bool FindTextSplit(const char* data, TextChunkState const& chunk, size_t& split, uint32_t& split_depth)
+{
+    StructuralIndexer indexer(chunk.escaped, chunk.in_string);
+    TextBlock block;
+    int64_t depth = chunk.depth;
+
+    for (size_t offset = chunk.start; offset < chunk.end; offset += 64)
+    {
+        size_t left = chunk.end - offset;
+        if (left >= 64)
+        {
+            ClassifyTextBlock(data + offset, block);
+        }
+        else
+        {
+            char tail[64];
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, data + offset, left);
+            ClassifyTextBlock(tail, block);
+        }
+        indexer.Index(block);
+
+        uint64_t braces = block.open_brace | block.close_brace;
+        while (braces != 0)
+        {
+            uint64_t bit = braces & (0 - braces);
+            braces ^= bit;
+            if ((block.open_brace & bit) != 0)
+            {
+                ++depth;
+            }
+            else if (--depth >= 1)
+            {
+                split = offset + CountTrailingZeros64(bit) + 1;
+                split_depth = (uint32_t)depth;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/// <summary>
+/// Parses a text VDF on several threads:
+///   the input is cut in chunks whose quotes and braces are counted in parallel,
+///   a prefix pass over the chunks gives the string state and depth at their start,
+///   each chunk is moved to its first end of object so the ranges start between two items,
+///   the ranges are parsed in parallel and the items are moved into their parent objects, in document order.
+/// Returns false when the input can't be split. The parse errors are thrown, but their line is relative to the range.
+/// </summary>
+inline bool ParseTextParallel(const char* data, size_t size, ParseOptions const& options, ValveDataObject& root)
+{
+    constexpr size_t min_chunk_size = EASYVDF_PARALLEL_MIN_CHUNK_SIZE;
+
+    size_t thread_count = options.threads == 0 ? std::thread::hardware_concurrency() : options.threads;
+    size_t chunk_count = size / min_chunk_size;
+    if (chunk_count > thread_count)
+        chunk_count = thread_count;
+
+    if (chunk_count < 2)
+        return false;
+
+    const char* token_start;
+    const char* token_end;
+    TextToken token;
+
+    // The root key and object start
+    BufferTextSource root_source(data, size, 1, options.validate_utf8);
+    token = root_source.Next(token_start, token_end);
+    if (token != TextToken::String && token != TextToken::Data)
+        return false;
+
+    std::string root_key;
+    StringView key = ReadTokenString(root_source, token_start, token_end, options.escape_sequences, true, root_key);
+    if (root_source.Next(token_start, token_end) != TextToken::ObjectStart)
+        return false;
+
+    size_t content_start = token_end - data;
+
+    // Chunks are multiple of the block size, so the blocks are the same as in the serial parse.
+    size_t chunk_size = ((size / chunk_count) + 63) & ~(size_t)63;
+    std::vector<TextChunkState> chunks(chunk_count);
+    for (size_t i = 0; i < chunk_count; ++i)
+    {
+        TextChunkState& chunk = chunks[i];
+        chunk.start = i * chunk_size < size ? i * chunk_size : size;
+        chunk.end = (i + 1) * chunk_size < size && (i + 1) != chunk_count ? (i + 1) * chunk_size : size;
+
+        // Backslashes only escape the next character, the escape state only depends on the backslashes before the chunk.
+        size_t backslash = chunk.start;
+        while (backslash != 0 && data[backslash - 1] == '\\')
+            --backslash;
+
+        chunk.escaped = ((chunk.start - backslash) & 1) != 0;
+    }
+
+    ParallelFor(chunk_count, thread_count, [&](size_t i)
+    {
+        CountTextChunk(data, chunks[i]);
+    });
+
+    bool in_string = false;
+    int64_t depth = 0;
+    for (auto& chunk : chunks)
+    {
+        chunk.in_string = in_string;
+        chunk.depth = depth;
+        depth += chunk.depth_delta[in_string ? 1 : 0];
+        in_string ^= chunk.quote_parity;
+    }
+
+    // Range starts and the number of objects opened at their start
+    std::vector<size_t> splits(chunk_count, 0);
+    std::vector<uint32_t> split_depths(chunk_count, 0);
+    std::vector<uint8_t> found(chunk_count, 0);
+    ParallelFor(chunk_count - 1, thread_count, [&](size_t i)
+    {
+        size_t split;
+        uint32_t split_depth;
+        if (FindTextSplit(data, chunks[i + 1], split, split_depth) && split > content_start)
+        {
+            splits[i + 1] = split;
+            split_depths[i + 1] = split_depth;
+            found[i + 1] = 1;
+        }
+    });
+
+    std::vector<size_t> range_starts(1, content_start);
+    std::vector<uint32_t> range_depths(1, 1);
+    for (size_t i = 1; i < chunk_count; ++i)
+    {
+        if (found[i])
+        {
+            range_starts.emplace_back(splits[i]);
+            range_depths.emplace_back(split_depths[i]);
+        }
+    }
+    if (range_starts.size() < 2)
+        return false;
+
+    std::vector<TextFragment> fragments(range_starts.size());
+    ParallelFor(range_starts.size(), thread_count, [&](size_t i)
+    {
+        size_t end = (i + 1) < range_starts.size() ? range_starts[i + 1] : size;
+        uint32_t range_depth = range_depths[i];
+
+        BufferTextSource source(data + range_starts[i], end - range_starts[i], 1, options.validate_utf8);
+        TextFragmentBuilder builder(fragments[i]);
+        ParseTextMembers(source, options, builder, range_depth);
+        builder.Finish();
+    });
+
+    // Move the items into their parents
+    ValveDataObjectBuilder root_builder(root);
+    root_builder.OnObjectBegin(key);
+
+    std::vector<ValveCollection*> stack(1, &root.Collection());
+    for (auto& fragment : fragments)
+    {
+        size_t item = 0;
+        for (size_t close : fragment.closes)
+        {
+            ValveCollection& parent = *stack.back();
+            parent.reserve(parent.size() + close - item);
+            for (; item != close; ++item)
+                parent.emplace_back(std::move(fragment.items[item]));
+
+            stack.pop_back();
+            if (stack.empty())
+                return true;
+        }
+
+        ValveCollection& parent = *stack.back();
+        if (item == 0 && parent.empty())
+        {
+            parent.swap(fragment.items);
+        }
+        else
+        {
+            parent.reserve(parent.size() + fragment.items.size() - item);
+            for (; item != fragment.items.size(); ++item)
+                parent.emplace_back(std::move(fragment.items[item]));
+        }
+
+        for (uint32_t level = 0; level < fragment.open_levels; ++level)
+            stack.emplace_back(&stack.back()->back().Collection());
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Object of a binary VDF above the split depth, or a range of whole items under one of them, in document order.
+/// </summary>
+struct BinarySkeletonItem
+{
+    enum class Kind : uint8_t
+    {
+        ObjectBegin,
+        ObjectEnd,
+        Range,
+    };
+
+    Kind kind;
+    // Key of ObjectBegin, items of Range.
+    size_t start;
+    size_t end;
+    // Objects opened at the start of a Range.
+    uint32_t depth;
+};
+
+/// <summary>
+/// Walks a binary VDF in memory without building anything: the objects above the split depth are added to the skeleton,
+/// the items under them are grouped in ranges of about range_size bytes.
+/// Returns false when the input is not a complete binary VDF, the serial parse reports its errors.
+/// </summary>
+inline bool ScanBinarySkeleton(const char* data, size_t size, ParseOptions const& options, size_t range_size, std::vector<BinarySkeletonItem>& skeleton)
+{
+    const char* b = data;
+    const char* e = data + size;
+    const char* range_start = nullptr;
+    uint32_t range_depth = 0;
+    uint32_t split_depth = options.binary_split_depth == 0 ? 1 : options.binary_split_depth;
+    StringView key;
+    StringView value;
+
+    auto end_range = [&](const char* range_end)
+    {
+        if (range_start != nullptr)
+        {
+            skeleton.push_back(BinarySkeletonItem{ BinarySkeletonItem::Kind::Range, (size_t)(range_start - data), (size_t)(range_end - data), range_depth });
+            range_start = nullptr;
+        }
+    };
+
+    if (b == e || *b++ != (int8_t)BinaryNodeType::Object || !ReadBinaryString(b, e, options.validate_utf8, key))
+        return false;
+
+    skeleton.push_back(BinarySkeletonItem{ BinarySkeletonItem::Kind::ObjectBegin, (size_t)(key.data() - data), (size_t)(key.data() + key.size() - data), 0 });
+    uint32_t depth = 1;
+
+    while (b != e)
+    {
+        const char* item_start = b;
+        BinaryNodeType type = (BinaryNodeType)*b++;
+        if (type == BinaryNodeType::ObjectEnd || type == BinaryNodeType::AlternativeEnd)
+        {
+            if (depth <= split_depth)
+            {
+                end_range(item_start);
+                skeleton.push_back(BinarySkeletonItem{ BinarySkeletonItem::Kind::ObjectEnd, 0, 0, 0 });
+            }
+            if (--depth == 0)
+                return true;
+
+            if (depth == split_depth && range_start != nullptr && b - range_start >= (ptrdiff_t)range_size)
+                end_range(b);
+
+            continue;
+        }
+
+        bool skeleton_object = type == BinaryNodeType::Object && depth < split_depth;
+        if (skeleton_object)
+        {
+            end_range(item_start);
+        }
+        else if (range_start == nullptr)
+        {
+            range_start = item_start;
+            range_depth = depth;
+        }
+
+        // The keys in the ranges are checked by their parse.
+        if (!ReadBinaryString(b, e, options.validate_utf8 && skeleton_object, key) || b == e)
+            return false;
+
+        switch (type)
+        {
+            case BinaryNodeType::Object:
+                if (depth >= options.max_depth)
+                    return false;
+
+                if (skeleton_object)
+                    skeleton.push_back(BinarySkeletonItem{ BinarySkeletonItem::Kind::ObjectBegin, (size_t)(key.data() - data), (size_t)(key.data() + key.size() - data), 0 });
+
+                ++depth;
+                continue;
+
+            case BinaryNodeType::String:
+                if (!ReadBinaryString(b, e, false, value))
+                    return false;
+
+                break;
+
+            case BinaryNodeType::WideString:
+            {
+                const char* string_end = FindWideStringEnd(b, e);
+                if (string_end == nullptr)
+                    return false;
+
+                b = string_end + 2;
+                break;
+            }
+
+            case BinaryNodeType::Binary:
+                if (!ReadBinaryBlob(b, e, value))
+                    return false;
+
+                break;
+
+            case BinaryNodeType::Int32:
+            case BinaryNodeType::Float:
+            case BinaryNodeType::Pointer:
+            case BinaryNodeType::Color:
+                if (e - b < 4)
+                    return false;
+
+                b += 4;
+                break;
+
+            case BinaryNodeType::Int64:
+            case BinaryNodeType::UInt64:
+                if (e - b < 8)
+                    return false;
+
+                b += 8;
+                break;
+
+            default:
+                return false;
+        }
+
+        if (depth <= split_depth && b - range_start >= (ptrdiff_t)range_size)
+            end_range(b);
+    }
+
+    // Premature end of file
+    return false;
+}
+
+/// <summary>
+/// Parses a binary VDF on several threads:
+///   a first pass walks the input without building anything and cuts it in ranges of whole items (see ScanBinarySkeleton),
+///   the ranges are parsed in parallel and their items are moved into the objects of the skeleton, in document order.
+/// Returns false when the input can't be split, or isn't a complete binary VDF.
+/// </summary>
+inline bool ParseBinaryParallel(const char* data, size_t size, ParseOptions const& options, ValveDataObject& root)
+{
+    constexpr size_t min_chunk_size = EASYVDF_PARALLEL_MIN_CHUNK_SIZE;
+
+    size_t thread_count = options.threads == 0 ? std::thread::hardware_concurrency() : options.threads;
+    if (thread_count < 2 || size / min_chunk_size < 2)
+        return false;
+
+    // Several ranges per thread, the threads that are done early take the next ones.
+    std::vector<BinarySkeletonItem> skeleton;
+    if (!ScanBinarySkeleton(data, size, options, size / (thread_count * 8), skeleton))
+        return false;
+
+    std::vector<size_t> ranges;
+    for (size_t i = 0; i < skeleton.size(); ++i)
+    {
+        if (skeleton[i].kind == BinarySkeletonItem::Kind::Range)
+            ranges.emplace_back(i);
+    }
+    if (ranges.size() < 2)
+        return false;
+
+    std::vector<TextFragment> fragments(ranges.size());
+    ParallelFor(ranges.size(), thread_count, [&](size_t i)
+    {
+        BinarySkeletonItem const& range = skeleton[ranges[i]];
+        const char* b = data + range.start;
+        uint32_t depth = range.depth;
+
+        TextFragmentBuilder builder(fragments[i]);
+        ParseBinaryMembers(b, data + range.end, options, builder, depth);
+    });
+
+    ValveDataObjectBuilder root_builder(root);
+    root_builder.OnObjectBegin(StringView(data + skeleton[0].start, skeleton[0].end - skeleton[0].start));
+
+    std::vector<ValveCollection*> stack(1, &root.Collection());
+    auto fragment = fragments.begin();
+    for (size_t i = 1; i < skeleton.size(); ++i)
+    {
+        BinarySkeletonItem const& item = skeleton[i];
+        switch (item.kind)
+        {
+            case BinarySkeletonItem::Kind::ObjectBegin:
+                stack.back()->emplace_back(std::string(data + item.start, data + item.end));
+                stack.emplace_back(&stack.back()->back().Collection());
+                break;
+
+            case BinarySkeletonItem::Kind::ObjectEnd:
+                stack.pop_back();
+                break;
+
+            case BinarySkeletonItem::Kind::Range:
+            {
+                ValveCollection& parent = *stack.back();
+                if (parent.empty())
+                {
+                    parent.swap(fragment->items);
+                }
+                else
+                {
+                    parent.reserve(parent.size() + fragment->items.size());
+                    for (auto& child : fragment->items)
+                        parent.emplace_back(std::move(child));
+                }
+                ++fragment;
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+}
+
+/// <summary>
+/// Read-only node of a ValveDataView.
+/// </summary>
+class ValveDataViewNode
+{
+    const Details::ViewNode* _Node;
+
+public:
+    class Iterator
+    {
+        const Details::ViewNode* _Node;
+
+    public:
+        Iterator(const Details::ViewNode* node) :
+            _Node(node)
+        {}
+
+        inline ValveDataViewNode operator*() const
+        {
+            return ValveDataViewNode(_Node);
+        }
+
+        inline Iterator& operator++()
+        {
+            _Node += _Node->span;
+            return *this;
+        }
+
+        inline bool operator==(Iterator const& other) const
+        {
+            return _Node == other._Node;
+        }
+
+        inline bool operator!=(Iterator const& other) const
+        {
+            return _Node != other._Node;
+        }
+    };
+
+    ValveDataViewNode(const Details::ViewNode* node) :
+        _Node(node)
+    {}
+
+    inline StringView Name() const;
+
+    inline ObjectType Type() const;
+
+    inline bool Empty() const;
+
+    inline StringView String() const;
+
+    inline StringView WideString() const;
+
+    inline StringView Binary() const;
+
+    inline int32_t Int32() const;
+
+    inline float Float() const;
+
+    inline pointer_t Pointer() const;
+
+    inline color_t Color() const;
+
+    inline int64_t Int64() const;
+
+    inline uint64_t UInt64() const;
+
+    // Number of children of an Object.
+    inline size_t Size() const;
+
+    inline Iterator begin() const;
+
+    inline Iterator end() const;
+
+    inline std::vector<ValveDataViewNode> operator[](StringView key) const;
+};
+
+/// <summary>
+/// Read-only document whose names and strings reference the parsed buffer, the buffer must outlive the view.
+/// Only the strings that are not stored as is in the buffer (escaped text strings, binary wide strings) are copied to the view.
+/// </summary>
+class ValveDataView
+{
+    friend class Details::ViewBuilder;
+
+    // Nodes in document order.
+    std::vector<Details::ViewNode> _Nodes;
+    std::vector<std::unique_ptr<char[]>> _Blocks;
+
+public:
+    ValveDataView() = default;
+
+    ValveDataView(ValveDataView&&) = default;
+
+    ValveDataView& operator=(ValveDataView&&) = default;
+
+    ValveDataView(ValveDataView const&) = delete;
+
+    ValveDataView& operator=(ValveDataView const&) = delete;
+
+    inline ValveDataViewNode Root() const;
+
+    // Parses a VDF (text or binary) that is already in memory.
+    static ValveDataView Parse(const char* data, size_t size, ParseOptions const& options = ParseOptions());
+};
+
+/// <summary>
+/// On-demand access to a text VDF in memory: nothing is parsed before it is navigated to, and the objects
+/// that are walked over are skipped by matching their braces. The buffer must outlive the cursors.
+/// </summary>
+class ValveDataCursor
+{
+    const char* _Data;
+    size_t _Size;
+    ParseOptions _Options;
+
+    ObjectType _Type;
+    StringView _Name;
+    StringView _String;
+    // Decoded name and string, when they have escape sequences.
+    std::string _NameBuffer;
+    std::string _StringBuffer;
+    bool _NameEscaped;
+    bool _StringEscaped;
+    // Objects: offset of their content in the buffer and its line.
+    size_t _Offset;
+    uint32_t _Line;
+
+    inline ValveDataCursor _Child() const;
+
+    static bool _ReadChild(Details::BufferTextSource& source, ValveDataCursor& child);
+
+public:
+    class Iterator;
+
+    ValveDataCursor();
+
+    inline StringView Name() const;
+
+    inline ObjectType Type() const;
+
+    inline bool Empty() const;
+
+    inline StringView String() const;
+
+    inline Iterator begin() const;
+
+    inline Iterator end() const;
+
+    // First child named key, an Empty cursor if there is none.
+    ValveDataCursor Find(StringView key) const;
+
+    std::vector<ValveDataCursor> operator[](StringView key) const;
+
+    // Parses the whole subtree.
+    ValveDataObject ToObject() const;
+
+    static ValveDataCursor Open(const char* data, size_t size, ParseOptions const& options = ParseOptions());
+};
+
+/// <summary>
+/// Pull parser: each call to Next reads the next item of a VDF (text or binary), without building any tree.
+/// Only the current key and value are kept, they are valid until the next call.
+/// </summary>
+class ValveDataReader
+{
+public:
+    enum class Token
+    {
+        End,
+        ObjectBegin,
+        ObjectEnd,
+        Value,
+    };
+
+private:
+    ParseOptions _Options;
+    bool _Binary;
+    Details::BinaryNodeType _BinaryRootEnd;
+    // Text stream blocks, or binary input.
+    std::string _Buffer;
+    std::unique_ptr<Details::BufferTextSource> _BufferText;
+    std::unique_ptr<Details::StreamTextSource> _StreamText;
+    std::unique_ptr<Details::BinaryInput> _BinaryInput;
+
+    bool _Started;
+    // The input ended inside of an object, the opened objects are being closed.
+    bool _Truncated;
+    uint32_t _Depth;
+    StringView _Key;
+    ValveDataValue _Value;
+    std::string _KeyBuffer;
+    std::string _ValueBuffer;
+    // Code units of a binary wide string.
+    std::string _UnitBuffer;
+
+    template<typename TextSource>
+    Token _NextText(TextSource& source);
+
+    Token _NextBinary();
+
+    Token _Close();
+
+public:
+    ValveDataReader(std::istream& is, ParseOptions const& options = ParseOptions());
+
+    // The buffer must outlive the reader.
+    ValveDataReader(const char* data, size_t size, ParseOptions const& options = ParseOptions());
+
+    ValveDataReader(ValveDataReader const&) = delete;
+
+    ValveDataReader& operator=(ValveDataReader const&) = delete;
+
+    Token Next();
+
+    // Skips the content of the object that was just begun, its ObjectEnd included.
+    void SkipObject();
+
+    // Key of the last ObjectBegin or Value.
+    inline StringView Key() const;
+
+    // Value of the last Value.
+    inline ValveDataValue const& Value() const;
+
+    // Number of opened objects.
+    inline uint32_t Depth() const;
+};
+
+/// <summary>
+/// Push parser: the input is given chunk by chunk as it arrives (network, decompression, ...), each Feed parses
+/// what it can and keeps its state for the next one. The items are reported to the handler as in ParseWithHandler,
+/// use a ValveDataObjectBuilder as the handler to get a ValveDataObject.
+/// After a ParserException, the parser can't be used anymore.
+/// </summary>
+template<typename Handler>
+class ValveDataPushParser
+{
+    enum class Format : uint8_t
+    {
+        Unknown,
+        Text,
+        Binary,
+    };
+
+    enum class Step : uint8_t
+    {
+        RootKey,
+        RootStart,
+        Key,
+        Value,
+        Done,
+    };
+
+    Handler& _Handler;
+    ParseOptions _Options;
+    Format _Format;
+    // Unparsed text, or the first bytes until the format is known.
+    std::string _Buffer;
+    Details::TextScanner _Scanner;
+    Details::BinaryParser _Binary;
+    // CRC of the parsed binary datas, and the one of the VBKV header when it is checked.
+    bool _VerifyCrc;
+    uint32_t _Crc;
+    uint32_t _StoredCrc;
+
+    Step _Step;
+    uint32_t _Depth;
+    std::string _Key;
+    std::string _Value;
+
+    bool _Detect(bool final);
+
+    void _ParseText();
+
+    void _ParseBinary(const char* data, size_t size);
+
+    void _FinishBinary();
+
+public:
+    ValveDataPushParser(Handler& handler, ParseOptions const& options = ParseOptions());
+
+    ValveDataPushParser(ValveDataPushParser const&) = delete;
+
+    ValveDataPushParser& operator=(ValveDataPushParser const&) = delete;
+
+    // Parses the next chunk of input, the chunk can be released once this returns.
+    void Feed(const char* data, size_t size);
+
+    // Signals the end of the input. On a premature end, the opened objects are closed.
+    void Finish();
+
+    // Whether the root object was closed, the input that follows is ignored.
+    inline bool Done() const;
+};
+
+/// <summary>
+/// Reader of the Steam appinfo.vdf (v27, v28, v29) and packageinfo.vdf (v27, v28) containers: the entries are indexed
+/// without being parsed, and the binary VDF of an entry is parsed on request. The buffer must outlive the container.
+/// </summary>
+class ValveDataContainer
+{
+public:
+    enum class Format : uint8_t
+    {
+        AppInfo,
+        PackageInfo,
+    };
+
+    struct Entry
+    {
+        // App or package id.
+        uint32_t id;
+        // appinfo only.
+        uint32_t info_state;
+        uint32_t last_updated;
+        // appinfo, and packageinfo v28.
+        uint64_t pics_token;
+        uint32_t change_number;
+        // appinfo: SHA-1 of the text VDF of the app, packageinfo: SHA-1 of the package.
+        uint8_t sha1[20];
+        // appinfo v28 and v29: SHA-1 of the binary VDF of the entry, zeros otherwise.
+        uint8_t binary_sha1[20];
+        // Binary VDF of the entry in the buffer.
+        size_t offset;
+        size_t size;
+    };
+
+private:
+    const char* _Data;
+    size_t _Size;
+    Format _Format;
+    uint32_t _Version;
+    uint32_t _Universe;
+    std::vector<Entry> _Entries;
+    // Indexes of the entries, sorted by id.
+    std::vector<uint32_t> _ById;
+    // String table of appinfo v29, the keys of its binary VDF are indexes into it.
+    Details::BinaryKeyTable _Keys;
+
+public:
+    ValveDataContainer();
+
+    inline Format ContainerFormat() const;
+
+    inline uint32_t Version() const;
+
+    inline uint32_t Universe() const;
+
+    // Entries in file order.
+    inline std::vector<Entry> const& Entries() const;
+
+    // Entry of the id, nullptr if there is none.
+    Entry const* Find(uint32_t id) const;
+
+    // Parses the binary VDF of the entry and reports it to the handler.
+    template<typename Handler>
+    void ParseWithHandler(Entry const& entry, Handler& handler, ParseOptions const& options = ParseOptions()) const;
+
+    ValveDataObject Parse(Entry const& entry, ParseOptions const& options = ParseOptions()) const;
+
+    // Parses the entry of the id, throws a ParserException if there is none.
+    ValveDataObject Parse(uint32_t id, ParseOptions const& options = ParseOptions()) const;
+
+    // Whether the binary VDF of the entry matches its binary_sha1, entries without one (appinfo v27, packageinfo) always match.
+    bool Verify(Entry const& entry) const;
+
+    // Parses every entry on options.threads threads (0 for one per hardware thread), keyed by id.
+    // With verify_checksums, the entries are verified in the same pass and a mismatch throws a ParserException.
+    std::map<uint32_t, ValveDataObject> ParseAll(ParseOptions const& options = ParseOptions(), bool verify_checksums = true) const;
+
+    // Reads the header and indexes the entries, throws a ParserException on unknown or truncated containers.
+    static ValveDataContainer Open(const char* data, size_t size);
+};
+
+class ValveDataCursor::Iterator
+{
+    Details::BufferTextSource _Source;
+    ValveDataCursor _Current;
+    bool _End;
+
+public:
+    Iterator(ValveDataCursor const& parent, bool end);
+
+    inline ValveDataCursor const& operator*() const
+    {
+        return _Current;
+    }
+
+    inline ValveDataCursor const* operator->() const
+    {
+        return &_Current;
+    }
+
+    Iterator& operator++();
+
+    // Iterators only compare equal once they reached the end.
+    inline bool operator==(Iterator const& other) const
+    {
+        return _End && other._End;
+    }
+
+    inline bool operator!=(Iterator const& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+
+/////////////////////////////////////////////////////////////////////
+// 
+//                        ValveDataObjectRef
+// 
+/////////////////////////////////////////////////////////////////////
+
+template<typename T>
+ValveDataObjectRefWrapper<T>::ValveDataObjectRefWrapper(T* obj):
+    _Obj(obj)
+{}
+
+template<typename T>
+ValveDataObjectRefWrapper<T>::ValveDataObjectRefWrapper(ValveDataObjectRefWrapper<T> const& o):
+    _Obj(o._Obj)
+{}
+
+template<typename T>
+inline std::string const& ValveDataObjectRefWrapper<T>::Name() const
+{
+    return _Obj->Name();
+}
+
+template<typename T>
+inline ObjectType ValveDataObjectRefWrapper<T>::Type() const
+{
+    return _Obj->Type();
+}
+
+template<typename T>
+inline bool ValveDataObjectRefWrapper<T>::Empty() const
+{
+    return _Obj->Empty();
+}
+
+template<typename T>
+inline std::string& ValveDataObjectRefWrapper<T>::String()
+{
+    return _Obj->String();
+}
+
+template<typename T>
+inline std::string const& ValveDataObjectRefWrapper<T>::String() const
+{
+    return _Obj->String();
+}
+
+template<typename T>
+inline std::string& ValveDataObjectRefWrapper<T>::WideString()
+{
+    return _Obj->WideString();
+}
+
+template<typename T>
+inline std::string const& ValveDataObjectRefWrapper<T>::WideString() const
+{
+    return _Obj->WideString();
+}
+
+template<typename T>
+inline std::string& ValveDataObjectRefWrapper<T>::Binary()
+{
+    return _Obj->Binary();
+}
+
+template<typename T>
+inline std::string const& ValveDataObjectRefWrapper<T>::Binary() const
+{
+    return _Obj->Binary();
+}
+
+template<typename T>
+inline ValveCollection& ValveDataObjectRefWrapper<T>::Collection()
+{
+    return _Obj->Collection();
+}
+
+template<typename T>
+inline ValveCollection const& ValveDataObjectRefWrapper<T>::Collection() const
+{
+    return _Obj->Collection();
+}
+
+template<typename T>
+inline bool ValveDataObjectRefWrapper<T>::operator==(std::nullptr_t)
+{
+    return (*_Obj) == nullptr;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(ValveDataObjectRefWrapper<T> const& value)
+{
+    (*_Obj) = *value._Obj;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(ValveDataObjectRefWrapper<T>&& value)
+{
+    (*_Obj) = std::move(*value._Obj);
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(T const& value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(T&& value)
+{
+    (*_Obj) = std::move(value);
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(std::nullptr_t)
+{
+    (*_Obj) = nullptr;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(std::string const& value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(std::string&& value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(int32_t value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(pointer_t value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(color_t value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(float value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(int64_t value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(uint64_t value)
+{
+    (*_Obj) = value;
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(wide_string_t value)
+{
+    (*_Obj) = std::move(value);
+    return *this;
+}
+
+template<typename T>
+inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(binary_t value)
+{
+    (*_Obj) = std::move(value);
+    return *this;
+}
+
+template<typename T>
+inline int32_t ValveDataObjectRefWrapper<T>::Int32() const
+{
+    return _Obj->Int32();
+}
+
+template<typename T>
+inline float ValveDataObjectRefWrapper<T>::Float() const
+{
+    return _Obj->Float();
+}
+
+template<typename T>
+inline pointer_t ValveDataObjectRefWrapper<T>::Pointer() const
+{
+    return _Obj->Pointer();
+}
+
+template<typename T>
+inline color_t ValveDataObjectRefWrapper<T>::Color() const
+{
+    return _Obj->Color();
+}
+
+template<typename T>
+inline int64_t ValveDataObjectRefWrapper<T>::Int64() const
+{
+    return _Obj->Int64();
+}
+
+template<typename T>
+inline uint64_t ValveDataObjectRefWrapper<T>::UInt64() const
+{
+    return _Obj->UInt64();
+}
+
+template<typename T>
+inline ValveCollectionRef ValveDataObjectRefWrapper<T>::operator[](const char* key)
+{
+    return (*_Obj)[key];
+}
+
+template<typename T>
+inline ValveCollectionRef ValveDataObjectRefWrapper<T>::operator[](std::string const& key)
+{
+    return (*_Obj)[key];
+}
+
+template<typename T>
+inline ValveCollectionConstRef ValveDataObjectRefWrapper<T>::operator[](const char* key) const
+{
+    return static_cast<const ValveDataObject&>(*_Obj)[key];
+}
+
+template<typename T>
+inline ValveCollectionConstRef ValveDataObjectRefWrapper<T>::operator[](std::string const& key) const
+{
+    return static_cast<const ValveDataObject&>(*_Obj)[key];
+}
+
+template<typename T>
+inline std::string ValveDataObjectRefWrapper<T>::SerializeAsText(bool escape_sequences) const
+{
+    return _Obj->SerializeAsText(escape_sequences);
+}
+
+template<typename T>
+inline std::string ValveDataObjectRefWrapper<T>::SerializeAsBinary(int version) const
+{
+    return _Obj->SerializeAsBinary(version);
+}
+
+template<typename T>
+inline void ValveDataObjectRefWrapper<T>::SerializeAsText(std::ostream& os, bool escape_sequences) const
+{
+    return _Obj->SerializeAsText(os, escape_sequences);
+}
+
+template<typename T>
+inline void ValveDataObjectRefWrapper<T>::SerializeAsBinary(std::ostream& os, int version) const
+{
+    return _Obj->SerializeAsBinary(os, version);
+}
+
+/////////////////////////////////////////////////////////////////////
+// 
+//                        ValveDataObject
+// 
+/////////////////////////////////////////////////////////////////////
+inline ValveDataObject::ValveDataObject() :
+    _Obj(new Data_t())
+{
+    _Obj->_Type = ObjectType::None;
+}
+
+inline ValveDataObject::ValveDataObject(ValveDataObject const& other):
+    _Obj(new Data_t())
+{
+    _Obj->_Name = other._Obj->_Name;
+    _Obj->_NameHash = other._Obj->_NameHash;
+    _Obj->_Type = other._Obj->_Type;
+    switch (_Obj->_Type)
+    {   // Copy pointers content
+        case ObjectType::String:
+        case ObjectType::WideString:
+        case ObjectType::Binary: _Obj->_U._String = new std::string(*other._Obj->_U._String); break;
+        case ObjectType::Object: _Obj->_U._Collection = new ValveCollection(*other._Obj->_U._Collection); break;
+        // Copy biggest possible value
+        default: _Obj->_U = other._Obj->_U;
+    }
+}
+
+inline ValveDataObject::ValveDataObject(ValveDataObject && other) noexcept :
+    _Obj(new Data_t())
+{
+    // Copy object name on creation
+    _Obj->_Name = other._Obj->_Name;
+    _Obj->_NameHash = other._Obj->_NameHash;
+    // But move content
+    (*this) = std::move(other);
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_Type = ObjectType::Object;
+    _Obj->_U._Collection = new ValveCollection();
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, ValveDataObject const& other) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_Type = ObjectType::Object;
+    _Obj->_U._Collection = new ValveCollection();
+    _Obj->_U._Collection->emplace_back(other);
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, ValveDataObject&& other) noexcept :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_Type = ObjectType::Object;
+    _Obj->_U._Collection = new ValveCollection();
+    _Obj->_U._Collection->emplace_back(std::move(other));
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, std::string const& value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._String = new std::string(value);
+    _Obj->_Type = ObjectType::String;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, std::string && value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._String = new std::string(std::move(value));
+    _Obj->_Type = ObjectType::String;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, int32_t value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._Int32 = value;
+    _Obj->_Type = ObjectType::Int32;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, float value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._Float = value;
+    _Obj->_Type = ObjectType::Float;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, pointer_t value):
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._Pointer = value;
+    _Obj->_Type = ObjectType::Pointer;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, color_t value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._Color = value;
+    _Obj->_Type = ObjectType::Color;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, int64_t value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._Int64 = value;
+    _Obj->_Type = ObjectType::Int64;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, uint64_t value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._UInt64 = value;
+    _Obj->_Type = ObjectType::UInt64;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, wide_string_t value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._String = new std::string(std::move(value.value));
+    _Obj->_Type = ObjectType::WideString;
+}
+
+inline ValveDataObject::ValveDataObject(std::string const& key, binary_t value) :
+    _Obj(new Data_t())
+{
+    _Obj->_Name = key;
+    _Obj->_NameHash = std::hash<std::string>()(key);
+    _Obj->_U._String = new std::string(std::move(value.value));
+    _Obj->_Type = ObjectType::Binary;
+}
+
+inline ValveDataObject::~ValveDataObject()
+{
+    _ResetValue();
+    delete _Obj;
+}
+
+inline void ValveDataObject::Name(std::string const& value)
+{
+    _Obj->_NameHash = std::hash<std::string>()(value);
+    _Obj->_Name = value;
+}
+
+inline void ValveDataObject::Name(std::string&& value)
+{
+    _Obj->_NameHash = std::hash<std::string>()(value);
+    _Obj->_Name = std::move(value);
+}
+
+inline std::string const& ValveDataObject::Name() const
+{
+    return _Obj->_Name;
+}
+
+inline ObjectType ValveDataObject::Type() const
+{
+    return _Obj->_Type;
+}
+
+inline bool ValveDataObject::Empty() const
+{
+    return _Obj->_Type == ObjectType::None;
+}
+
+inline std::string& ValveDataObject::String()
+{
+    if (_Obj->_Type != ObjectType::String)
+    {
+        throw std::invalid_argument("Attempted to read a String from a non String type.");
+    }
+
+    return *_Obj->_U._String;
+}
+
+inline std::string const& ValveDataObject::String() const
+{
+    if (_Obj->_Type != ObjectType::String)
+    {
+        throw std::invalid_argument("Attempted to read a String from a non String type.");
+    }
+    
+    return *_Obj->_U._String;
+}
+
+inline std::string& ValveDataObject::WideString()
+{
+    if (_Obj->_Type != ObjectType::WideString)
+    {
+        throw std::invalid_argument("Attempted to read a WideString from a non WideString type.");
+    }
+
+    return *_Obj->_U._String;
+}
+
+inline std::string const& ValveDataObject::WideString() const
+{
+    if (_Obj->_Type != ObjectType::WideString)
+    {
+        throw std::invalid_argument("Attempted to read a WideString from a non WideString type.");
+    }
+
+    return *_Obj->_U._String;
+}
+
+inline std::string& ValveDataObject::Binary()
+{
+    if (_Obj->_Type != ObjectType::Binary)
+    {
+        throw std::invalid_argument("Attempted to read a Binary from a non Binary type.");
+    }
+
+    return *_Obj->_U._String;
+}
+
+inline std::string const& ValveDataObject::Binary() const
+{
+    if (_Obj->_Type != ObjectType::Binary)
+    {
+        throw std::invalid_argument("Attempted to read a Binary from a non Binary type.");
+    }
+
+    return *_Obj->_U._String;
+}
+
+inline ValveCollection& ValveDataObject::Collection()
+{
+    if (_Obj->_Type != ObjectType::Object)
+    {
+        throw std::invalid_argument("Attempted to get a Collection from non Collection type.");
+    }
+
+    return *_Obj->_U._Collection;
+}
+
+inline ValveCollection const& ValveDataObject::Collection() const
+{
+    if (_Obj->_Type != ObjectType::Object)
+    {
+        throw std::invalid_argument("Attempted to get a Collection from non Collection type.");
+    }
+
+    return *_Obj->_U._Collection;
+}
+
+inline bool ValveDataObject::operator==(std::nullptr_t)
+{
+    return Empty();
+}
+
+inline ValveDataObject& ValveDataObject::operator=(ValveDataObject const& value)
+{
+    std::cout << "Copy" << std::endl;
+    return (*this = ValveDataObject(value));
+}
+
+inline ValveDataObject& ValveDataObject::operator=(ValveDataObject&& value) noexcept
+{
+    auto type = value._Obj->_Type;
+    auto v = value._Obj->_U;
+    
+    value._Obj->_Type = _Obj->_Type;
+    value._Obj->_U = _Obj->_U;
+
+    _Obj->_Type = type;
+    _Obj->_U = v;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(std::nullptr_t)
+{
+    _ResetValue();
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(std::string const& value)
+{
+    std::string* v = new std::string(value);
+    _ResetValue();
+    _Obj->_U._String = v;
+    _Obj->_Type = ObjectType::String;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(std::string&& value)
+{
+    std::string* v = new std::string(std::move(value));
+    _ResetValue();
+    _Obj->_U._String = v;
+    _Obj->_Type = ObjectType::String;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(int32_t value)
+{
+    _ResetValue();
+    _Obj->_U._Int32 = value;
+    _Obj->_Type = ObjectType::Int32;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(pointer_t value)
+{
+    _ResetValue();
+    _Obj->_U._Pointer = value;
+    _Obj->_Type = ObjectType::Int32;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(color_t value)
+{
+    _ResetValue();
+    _Obj->_U._Color = value;
+    _Obj->_Type = ObjectType::Int32;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(float value)
+{
+    _ResetValue();
+    _Obj->_U._Float = value;
+    _Obj->_Type = ObjectType::Float;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(int64_t value)
+{
+    _ResetValue();
+    _Obj->_U._Int64 = value;
+    _Obj->_Type = ObjectType::Int64;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(uint64_t value)
+{
+    _ResetValue();
+    _Obj->_U._UInt64 = value;
+    _Obj->_Type = ObjectType::UInt64;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(wide_string_t value)
+{
+    std::string* v = new std::string(std::move(value.value));
+    _ResetValue();
+    _Obj->_U._String = v;
+    _Obj->_Type = ObjectType::WideString;
+
+    return *this;
+}
+
+inline ValveDataObject& ValveDataObject::operator=(binary_t value)
+{
+    std::string* v = new std::string(std::move(value.value));
+    _ResetValue();
+    _Obj->_U._String = v;
+    _Obj->_Type = ObjectType::Binary;
+
+    return *this;
+}
+
+inline int32_t ValveDataObject::Int32() const
+{
+    if (_Obj->_Type != ObjectType::Int32)
+    {
+        throw std::invalid_argument("Attempted to get an Int32 from non Int32 type.");
+    }
+
+    return _Obj->_U._Int32;
+}
+
+inline float ValveDataObject::Float() const
+{
+    if (_Obj->_Type != ObjectType::Float)
+    {
+        throw std::invalid_argument("Attempted to get a Float from non Float type.");
+    }
+
+    return _Obj->_U._Float;
 }
 
-template<typename T>
-inline bool ValveDataObjectRefWrapper<T>::Empty() const
+inline pointer_t ValveDataObject::Pointer() const
 {
-    return _Obj->Empty();
+    if (_Obj->_Type != ObjectType::Pointer)
+    {
+        throw std::invalid_argument("Attempted to get a Pointer from non Pointer type.");
+    }
+
+    return _Obj->_U._Pointer;
 }
 
-template<typename T>
-inline std::string& ValveDataObjectRefWrapper<T>::String()
+inline color_t ValveDataObject::Color() const
 {
-    return _Obj->String();
+    if (_Obj->_Type != ObjectType::Color)
+    {
+        throw std::invalid_argument("Attempted to get a Pointer from non Pointer type.");
+    }
+
+    return _Obj->_U._Color;
 }
 
-template<typename T>
-inline std::string const& ValveDataObjectRefWrapper<T>::String() const
+inline int64_t ValveDataObject::Int64() const
 {
-    return _Obj->String();
+    if (_Obj->_Type != ObjectType::Int64)
+    {
+        throw std::invalid_argument("Attempted to get an Int64 from non Int64 type.");
+    }
+
+    return _Obj->_U._Int64;
 }
 
-template<typename T>
-inline ValveCollection& ValveDataObjectRefWrapper<T>::Collection()
+inline uint64_t ValveDataObject::UInt64() const
 {
-    return _Obj->Collection();
+    if (_Obj->_Type != ObjectType::UInt64)
+    {
+        throw std::invalid_argument("Attempted to get an UInt64 from non UInt64 type.");
+    }
+
+    return _Obj->_U._UInt64;
 }
 
-template<typename T>
-inline ValveCollection const& ValveDataObjectRefWrapper<T>::Collection() const
+inline ValveCollectionRef ValveDataObject::operator[](const char* key)
 {
-    return _Obj->Collection();
+    return (*this)[std::string(key)];
 }
 
-template<typename T>
-inline bool ValveDataObjectRefWrapper<T>::operator==(std::nullptr_t)
+inline ValveCollectionRef ValveDataObject::operator[](std::string const& key)
 {
-    return (*_Obj) == nullptr;
+    auto& c = Collection();
+
+    ValveCollectionRef r;
+    size_t key_hash = std::hash<std::string>()(key);
+
+    for (auto& item : c)
+    {
+        if (item._Obj->_NameHash == key_hash)
+            r.emplace_back(ValveDataObjectRef(&item));
+    }
+
+    return r;
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(ValveDataObjectRefWrapper<T> const& value)
+inline ValveCollectionConstRef ValveDataObject::operator[](const char* key) const
 {
-    (*_Obj) = *value._Obj;
-    return *this;
+    return (*this)[std::string(key)];
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(ValveDataObjectRefWrapper<T>&& value)
+inline ValveCollectionConstRef ValveDataObject::operator[](std::string const& key) const
 {
-    (*_Obj) = std::move(*value._Obj);
-    return *this;
+    auto& c = Collection();
+
+    ValveCollectionConstRef r;
+    size_t key_hash = std::hash<std::string>()(key);
+
+    for (auto& item : c)
+    {
+        if (item._Obj->_NameHash == key_hash)
+            r.emplace_back(ValveDataObjectConstRef(&item));
+    }
+
+    return r;
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(T const& value)
+inline void ValveDataObject::_ResetValue()
 {
-    (*_Obj) = value;
-    return *this;
+    if (_Obj == nullptr)
+        return;
+
+    switch (_Obj->_Type)
+    {
+        case ObjectType::String:
+        case ObjectType::WideString:
+        case ObjectType::Binary: delete _Obj->_U._String; break;
+        case ObjectType::Object: delete _Obj->_U._Collection; break;
+        default: break; // Warning fix.
+    }
+    _Obj->_Type = ObjectType::None;
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(T&& value)
+inline void ValveDataObject::_WriteTextString(std::ostream& os, std::string const& str, bool escape_sequences)
 {
-    (*_Obj) = std::move(value);
-    return *this;
+    if (escape_sequences)
+    {
+        Details::WriteEscapedString(os, str);
+    }
+    else if (!Details::WriteRawString(os, str))
+    {
+        throw SerializeException("Can't serialize string without escape sequences, it has an unescaped quote or ends with a backslash.");
+    }
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(std::nullptr_t)
+inline void ValveDataObject::_SerializeAsText(std::ostream& os, size_t depth, bool escape_sequences) const
 {
-    (*_Obj) = nullptr;
-    return *this;
+    std::string indent(depth, '\t');
+
+    os << indent;
+    _WriteTextString(os, _Obj->_Name, escape_sequences);
+    switch (_Obj->_Type)
+    {
+        case ObjectType::Object:
+            os << '\n' << indent << "{\n";
+            for (auto const& item : *_Obj->_U._Collection)
+            {
+                item._SerializeAsText(os, depth + 1, escape_sequences);
+            }
+            os << indent << "}\n";
+            break;
+
+        case ObjectType::Pointer: os << "\t\t\"" << _Obj->_U._Pointer.value << "\"\n"; break;
+        case ObjectType::Color  : os << "\t\t\"" << _Obj->_U._Color.value   << "\"\n"; break;
+        case ObjectType::Float  : os << "\t\t\"" << _Obj->_U._Float         << "\"\n"; break;
+        case ObjectType::Int32  : os << "\t\t\"" << _Obj->_U._Int32         << "\"\n"; break;
+        case ObjectType::Int64  : os << "\t\t\"" << _Obj->_U._Int64         << "\"\n"; break;
+        case ObjectType::UInt64 : os << "\t\t\"" << _Obj->_U._UInt64        << "\"\n"; break;
+        case ObjectType::String : os << "\t\t"; _WriteTextString(os, *_Obj->_U._String, escape_sequences); os << '\n'; break;
+        case ObjectType::WideString: os << "\t\t"; _WriteTextString(os, *_Obj->_U._String, escape_sequences); os << '\n'; break;
+        // Text VDF has no binary type, the bytes are written in hexadecimal.
+        case ObjectType::Binary : os << "\t\t\""; Details::WriteHexString(os, *_Obj->_U._String); os << "\"\n"; break;
+
+        case ObjectType::None: break; // Warning fix.
+    }
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(std::string const& value)
+inline void ValveDataObject::_SerializeAsBinary(std::ostream& os, BinaryNodeType object_end) const
 {
-    (*_Obj) = value;
-    return *this;
+    os.write((const char*)&_Obj->_Type, 1);
+    os.write(_Obj->_Name.c_str(), _Obj->_Name.length() + 1);
+
+    switch (_Obj->_Type)
+    {
+        case ObjectType::Object:
+            for (auto const& item : *_Obj->_U._Collection)
+            {
+                item._SerializeAsBinary(os, object_end);
+            }
+            os.write((const char*)&object_end, 1);
+            break;
+    
+        case ObjectType::Pointer: os.write((const char*)&_Obj->_U._Pointer, 4); break;
+        case ObjectType::Color  : os.write((const char*)&_Obj->_U._Color, 4); break;
+        case ObjectType::Float  : os.write((const char*)&_Obj->_U._Float, 4); break;
+        case ObjectType::Int32  : os.write((const char*)&_Obj->_U._Int32, 4); break;
+        case ObjectType::Int64  : os.write((const char*)&_Obj->_U._Int64, 8); break;
+        case ObjectType::UInt64 : os.write((const char*)&_Obj->_U._UInt64, 8); break;
+        case ObjectType::String : os.write(_Obj->_U._String->c_str(), _Obj->_U._String->length() + 1); break;
+
+        case ObjectType::WideString:
+        {
+            std::string units;
+            if (!Details::Utf8ToUtf16(*_Obj->_U._String, units))
+                throw SerializeException("Can't serialize WideString item, it isn't valid UTF-8.");
+
+            units.append(2, '\0');
+            os.write(units.data(), units.length());
+            break;
+        }
+
+        case ObjectType::Binary:
+        {
+            if (_Obj->_U._String->length() > UINT32_MAX)
+                throw SerializeException("Can't serialize Binary item, it is bigger than 4GB.");
+
+            uint32_t size = (uint32_t)_Obj->_U._String->length();
+            os.write((const char*)&size, sizeof(size));
+            os.write(_Obj->_U._String->data(), size);
+            break;
+        }
+
+        case ObjectType::None: break; // Warning fix.
+    }
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(std::string&& value)
+inline std::string ValveDataObject::SerializeAsBinary(int version) const
 {
-    (*_Obj) = value;
-    return *this;
+    std::stringstream sstr;
+    SerializeAsBinary(sstr, version);
+    return sstr.str();
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(int32_t value)
+inline void ValveDataObject::SerializeAsBinary(std::ostream& os, int version) const
 {
-    (*_Obj) = value;
-    return *this;
+    if (_Obj->_Type != ObjectType::Object)
+        throw SerializeException("Can't serialize ValveDataObject, it needs to be an Object type.");
+
+    if (version <= 1)
+    {
+        _SerializeAsBinary(os, BinaryNodeType::ObjectEnd);
+        return;
+    }
+
+    // The CRC of the content is written before it, and the stream may not be seekable.
+    std::stringstream content;
+    _SerializeAsBinary(content, BinaryNodeType::AlternativeEnd);
+    std::string data = content.str();
+    uint32_t crc = Details::Crc32(0, data.data(), data.length());
+
+    os.write((const char*)&BinaryVDFMagic, 4);
+    os.write((const char*)&crc, 4);
+    os.write(data.data(), data.length());
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(pointer_t value)
+inline std::string ValveDataObject::SerializeAsText(bool escape_sequences) const
 {
-    (*_Obj) = value;
-    return *this;
+    std::stringstream sstr;
+    SerializeAsText(sstr, escape_sequences);
+    return sstr.str();
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(color_t value)
+inline void ValveDataObject::SerializeAsText(std::ostream& os, bool escape_sequences) const
 {
-    (*_Obj) = value;
-    return *this;
+    if (_Obj->_Type != ObjectType::Object)
+        throw SerializeException("Can't serialize ValveDataObject, it needs to be an Object type.");
+
+    _SerializeAsText(os, 0, escape_sequences);
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(float value)
+inline ValveDataObject ValveDataObject::ParseObject(std::istream& is, size_t chunk_size)
 {
-    (*_Obj) = value;
-    return *this;
+    ParseOptions options;
+    options.chunk_size = chunk_size;
+    return ParseObject(is, options);
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(int64_t value)
+inline ValveDataObject ValveDataObject::ParseObject(std::istream& is, ParseOptions const& options)
 {
-    (*_Obj) = value;
-    return *this;
+    ValveDataObject parsed_object;
+    ValveDataObjectBuilder builder(parsed_object);
+    std::vector<Details::TextDirective> directives;
+
+    Details::ParseStream(is, builder, options, options.resolver != nullptr ? &directives : nullptr);
+    if (!directives.empty())
+    {
+        Details::IncludeState state;
+        parsed_object._ApplyDirectives(directives, std::string(), options, state);
+    }
+    return parsed_object;
 }
 
-template<typename T>
-inline ValveDataObjectRefWrapper<T>& ValveDataObjectRefWrapper<T>::operator=(uint64_t value)
+inline ValveDataObject ValveDataObject::ParseObject(const char* data, size_t size)
 {
-    (*_Obj) = value;
-    return *this;
+    return ParseObject(data, size, ParseOptions());
 }
 
-template<typename T>
-inline int32_t ValveDataObjectRefWrapper<T>::Int32() const
+inline ValveDataObject ValveDataObject::ParseObject(const char* data, size_t size, ParseOptions const& options)
 {
-    return _Obj->Int32();
+    ValveDataObject parsed_object;
+    ValveDataObjectBuilder builder(parsed_object);
+
+    // Skipped subtrees may cross the ranges parsed by each thread.
+    if (options.threads != 1 && options.defines == nullptr)
+    {
+        const char* input = data;
+        size_t input_size = size;
+        BinaryNodeType binary_root_end;
+        bool as_binary = Details::DetectBufferFormat(input, input_size, binary_root_end);
+        try
+        {
+            if (as_binary ? !options.verify_crc && Details::ParseBinaryParallel(input, input_size, options, parsed_object) : Details::ParseTextParallel(data, size, options, parsed_object))
+                return parsed_object;
+        }
+        catch (ParserException&)
+        {// Parse again on this thread, so the error is the same as without threads.
+        }
+    }
+
+    std::vector<Details::TextDirective> directives;
+    Details::ParseBuffer(data, size, builder, options, options.resolver != nullptr ? &directives : nullptr);
+    if (!directives.empty())
+    {
+        Details::IncludeState state;
+        parsed_object._ApplyDirectives(directives, std::string(), options, state);
+    }
+    return parsed_object;
 }
 
-template<typename T>
-inline float ValveDataObjectRefWrapper<T>::Float() const
+inline ValveDataObject ValveDataObject::ParseObject(const char* data, size_t size, std::vector<ParseDiagnostic>& diagnostics, ParseOptions const& options)
 {
-    return _Obj->Float();
-}
+    ValveDataObject parsed_object;
+    ValveDataObjectBuilder builder(parsed_object);
+    Details::DiagnosticCollector collector(diagnostics, data, size);
+    size_t first_diagnostic = diagnostics.size();
+
+    const char* input = data;
+    size_t input_size = size;
+    BinaryNodeType binary_root_end;
+    uint32_t stored_crc;
+    bool as_binary;
+    try
+    {
+        as_binary = Details::DetectBufferFormat(input, input_size, binary_root_end, &stored_crc);
+    }
+    catch (ParserException& e)
+    {
+        collector.Add(ParseDiagnostic::Kind::InvalidInput, size, e.what());
+        return parsed_object;
+    }
+
+    if (as_binary)
+    {
+        const char* content = input;
+        try
+        {
+            Details::ParseBinaryBuffer(input, content + input_size, options, builder);
+            if (options.verify_crc && binary_root_end == BinaryNodeType::AlternativeEnd)
+                Details::CheckBinaryCrc(Details::Crc32(0, content, input - content), stored_crc);
+        }
+        catch (ParserException& e)
+        {
+            collector.Add(ParseDiagnostic::Kind::InvalidInput, input, e.what());
+        }
+        return parsed_object;
+    }
+
+    if (options.validate_utf8)
+        Details::CollectUtf8Errors(data, size, collector);
+
+    std::vector<Details::TextDirective> directives;
+    Details::BufferTextSource source(data, size);
+    Details::ParseText(source, options, builder, options.resolver != nullptr ? &directives : nullptr, &collector);
+    if (!directives.empty())
+    {
+        try
+        {
+            Details::IncludeState state;
+            parsed_object._ApplyDirectives(directives, std::string(), options, state);
+        }
+        catch (ParserException& e)
+        {// The directives are before the root key
+            collector.Add(ParseDiagnostic::Kind::InvalidDirective, (size_t)0, e.what());
+        }
+    }
 
-template<typename T>
-inline pointer_t ValveDataObjectRefWrapper<T>::Pointer() const
-{
-    return _Obj->Pointer();
+    // The UTF-8 errors were collected first
+    std::stable_sort(diagnostics.begin() + first_diagnostic, diagnostics.end(), [](ParseDiagnostic const& a, ParseDiagnostic const& b)
+    {
+        return a.offset < b.offset;
+    });
+    return parsed_object;
 }
 
-template<typename T>
-inline color_t ValveDataObjectRefWrapper<T>::Color() const
+inline ValveDataObject ValveDataObject::ParseFile(std::string const& path, ParseOptions const& options)
 {
-    return _Obj->Color();
-}
+    ValveDataFileResolver file_resolver;
+    ParseOptions file_options = options;
+    if (file_options.resolver == nullptr)
+        file_options.resolver = &file_resolver;
 
-template<typename T>
-inline int64_t ValveDataObjectRefWrapper<T>::Int64() const
-{
-    return _Obj->Int64();
-}
+    std::string content;
+    if (!file_options.resolver->Read(path, content))
+    {
+        throw ParserException("Failed to read file \"" + path + "\".");
+    }
 
-template<typename T>
-inline uint64_t ValveDataObjectRefWrapper<T>::UInt64() const
-{
-    return _Obj->UInt64();
+    Details::IncludeState state;
+    state.loading.push_back(path);
+    return _ParseFragment(content, path, file_options, state);
 }
 
-template<typename T>
-inline ValveCollectionRef ValveDataObjectRefWrapper<T>::operator[](const char* key)
+inline ValveDataObject ValveDataObject::_ParseFragment(std::string const& content, std::string const& path, ParseOptions const& options, Details::IncludeState& state)
 {
-    return (*_Obj)[key];
-}
+    ValveDataObject parsed_object;
+    ValveDataObjectBuilder builder(parsed_object);
+    std::vector<Details::TextDirective> directives;
 
-template<typename T>
-inline ValveCollectionRef ValveDataObjectRefWrapper<T>::operator[](std::string const& key)
-{
-    return (*_Obj)[key];
+    Details::ParseBuffer(content.data(), content.length(), builder, options, &directives);
+    parsed_object._ApplyDirectives(directives, path, options, state);
+    return parsed_object;
 }
 
-template<typename T>
-inline ValveCollectionConstRef ValveDataObjectRefWrapper<T>::operator[](const char* key) const
+inline std::shared_ptr<const ValveDataObject> ValveDataObject::_LoadFragment(std::string const& path, ParseOptions const& options, Details::IncludeState& state)
 {
-    return static_cast<const ValveDataObject&>(*_Obj)[key];
-}
+    int64_t mtime;
+    if (!options.resolver->Stat(path, mtime))
+    {
+        throw ParserException("Failed to find included file \"" + path + "\".");
+    }
 
-template<typename T>
-inline ValveCollectionConstRef ValveDataObjectRefWrapper<T>::operator[](std::string const& key) const
-{
-    return static_cast<const ValveDataObject&>(*_Obj)[key];
-}
+    std::shared_ptr<const ValveDataObject> fragment;
+    if (options.include_cache != nullptr)
+        fragment = options.include_cache->Find(path, mtime, options, state.dependencies);
 
-template<typename T>
-inline std::string ValveDataObjectRefWrapper<T>::SerializeAsText() const
-{
-    return _Obj->SerializeAsText();
-}
+    if (fragment == nullptr)
+    {
+        for (auto const& parent : state.loading)
+        {
+            if (parent == path)
+                throw ParserException("Recursive inclusion of \"" + path + "\".");
+        }
 
-template<typename T>
-inline std::string ValveDataObjectRefWrapper<T>::SerializeAsBinary(int version) const
-{
-    return _Obj->SerializeAsBinary(version);
+        std::string content;
+        if (!options.resolver->Read(path, content))
+        {
+            throw ParserException("Failed to read included file \"" + path + "\".");
+        }
+
+        size_t first_dependency = state.dependencies.size();
+        state.loading.push_back(path);
+        fragment = std::make_shared<const ValveDataObject>(_ParseFragment(content, path, options, state));
+        state.loading.pop_back();
+
+        if (options.include_cache != nullptr)
+        {
+            std::vector<Details::IncludeDependency> dependencies(state.dependencies.begin() + first_dependency, state.dependencies.end());
+            options.include_cache->Insert(path, mtime, options, fragment, std::move(dependencies));
+        }
+    }
+
+    state.dependencies.push_back(Details::IncludeDependency{ path, mtime });
+    return fragment;
 }
 
-template<typename T>
-inline void ValveDataObjectRefWrapper<T>::SerializeAsText(std::ostream& os) const
+inline void ValveDataObject::_ApplyDirectives(std::vector<Details::TextDirective> const& directives, std::string const& from, ParseOptions const& options, Details::IncludeState& state)
 {
-    return _Obj->SerializeAsText(os);
+    for (auto const& directive : directives)
+    {
+        std::shared_ptr<const ValveDataObject> fragment = _LoadFragment(options.resolver->Resolve(from, directive.path), options, state);
+        if (fragment->Type() != ObjectType::Object)
+            continue;
+
+        if (Type() != ObjectType::Object)
+        {// The document only has directives, it becomes an empty object named like the fragment.
+            _ResetValue();
+            Name(fragment->Name());
+            _Obj->_U._Collection = new ValveCollection();
+            _Obj->_Type = ObjectType::Object;
+        }
+
+        if (directive.type == Details::DirectiveType::Base)
+        {
+            _MergeBase(*fragment);
+        }
+        else
+        {
+            auto& collection = Collection();
+            collection.insert(collection.end(), fragment->Collection().begin(), fragment->Collection().end());
+        }
+    }
 }
 
-template<typename T>
-inline void ValveDataObjectRefWrapper<T>::SerializeAsBinary(std::ostream& os, int version) const
+inline void ValveDataObject::_MergeBase(ValveDataObject const& base)
 {
-    return _Obj->SerializeAsBinary(os, version);
+    auto& collection = Collection();
+    // Index of the first item of each name, the items of the base that are added can be found by the next ones.
+    std::unordered_map<std::string, size_t> indices;
+    indices.reserve(collection.size() + base.Collection().size());
+    for (size_t i = 0; i < collection.size(); ++i)
+        indices.emplace(collection[i].Name(), i);
+
+    for (auto const& item : base.Collection())
+    {
+        auto found = indices.emplace(item.Name(), collection.size());
+        if (found.second)
+        {
+            collection.emplace_back(item);
+        }
+        else
+        {
+            auto& existing = collection[found.first->second];
+            if (existing.Type() == ObjectType::Object && item.Type() == ObjectType::Object)
+                existing._MergeBase(item);
+        }
+    }
 }
 
 /////////////////////////////////////////////////////////////////////
-// 
-//                        ValveDataObject
-// 
+//                                                                 //
+//                        ValveDataView                            //
+//                                                                 //
 /////////////////////////////////////////////////////////////////////
-inline ValveDataObject::ValveDataObject() :
-    _Obj(new Data_t())
-{
-    _Obj->_Type = ObjectType::None;
-}
+namespace Details {
 
-inline ValveDataObject::ValveDataObject(ValveDataObject const& other):
-    _Obj(new Data_t())
+inline ViewBuilder::ViewBuilder(ValveDataView& view, const char* input, size_t size) :
+    _View(view),
+    _InputStart(input),
+    _InputEnd(input + size),
+    _Block(nullptr),
+    _BlockLeft(0)
+{}
+
+inline StringView ViewBuilder::_Store(StringView str)
 {
-    _Obj->_Name = other._Obj->_Name;
-    _Obj->_NameHash = other._Obj->_NameHash;
-    _Obj->_Type = other._Obj->_Type;
-    switch (_Obj->_Type)
-    {   // Copy pointers content
-        case ObjectType::String: _Obj->_U._String = new std::string(*other._Obj->_U._String); break;
-        case ObjectType::Object: _Obj->_U._Collection = new ValveCollection(*other._Obj->_U._Collection); break;
-        // Copy biggest possible value
-        default: _Obj->_U = other._Obj->_U;
+    if (reinterpret_cast<uintptr_t>(str.data()) >= reinterpret_cast<uintptr_t>(_InputStart) &&
+        reinterpret_cast<uintptr_t>(str.data() + str.size()) <= reinterpret_cast<uintptr_t>(_InputEnd))
+    {
+        return str;
     }
+
+    // Decoded string, copy it into the view.
+    constexpr size_t block_size = 4096;
+    if (str.size() > _BlockLeft)
+    {
+        size_t size = str.size() > block_size ? str.size() : block_size;
+        _View._Blocks.emplace_back(new char[size]);
+        _Block = _View._Blocks.back().get();
+        _BlockLeft = size;
+    }
+
+    char* copy = _Block;
+    memcpy(copy, str.data(), str.size());
+    _Block += str.size();
+    _BlockLeft -= str.size();
+    return StringView(copy, str.size());
 }
 
-inline ValveDataObject::ValveDataObject(ValveDataObject && other) noexcept :
-    _Obj(new Data_t())
+inline ViewNode& ViewBuilder::_AddNode(StringView key, ObjectType type)
 {
-    // Copy object name on creation
-    _Obj->_Name = other._Obj->_Name;
-    _Obj->_NameHash = other._Obj->_NameHash;
-    // But move content
-    (*this) = std::move(other);
+    if (!_Stack.empty())
+        ++_View._Nodes[_Stack.back()].size;
+
+    _View._Nodes.emplace_back();
+    ViewNode& node = _View._Nodes.back();
+    node.name = _Store(key);
+    node.span = 1;
+    node.size = 0;
+    node.type = type;
+    return node;
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key) :
-    _Obj(new Data_t())
+inline void ViewBuilder::OnObjectBegin(StringView key)
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_Type = ObjectType::Object;
-    _Obj->_U._Collection = new ValveCollection();
+    _AddNode(key, ObjectType::Object);
+    _Stack.emplace_back((uint32_t)(_View._Nodes.size() - 1));
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, ValveDataObject const& other) :
-    _Obj(new Data_t())
+inline void ViewBuilder::OnObjectEnd()
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_Type = ObjectType::Object;
-    _Obj->_U._Collection = new ValveCollection();
-    _Obj->_U._Collection->emplace_back(other);
+    uint32_t index = _Stack.back();
+    _Stack.pop_back();
+    _View._Nodes[index].span = (uint32_t)(_View._Nodes.size() - index);
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, ValveDataObject&& other) noexcept :
-    _Obj(new Data_t())
+inline void ViewBuilder::OnValue(StringView key, ValveDataValue const& value)
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_Type = ObjectType::Object;
-    _Obj->_U._Collection = new ValveCollection();
-    _Obj->_U._Collection->emplace_back(std::move(other));
+    ViewNode& node = _AddNode(key, value.Type());
+    switch (value.Type())
+    {
+        case ObjectType::String    : node.value = ValveDataValue(_Store(value.String())); break;
+        // Binary blobs are in the input, the wide strings are converted.
+        case ObjectType::WideString: node.value = ValveDataValue(ObjectType::WideString, _Store(value.WideString())); break;
+        case ObjectType::Binary    : node.value = ValveDataValue(ObjectType::Binary, _Store(value.Binary())); break;
+        default: node.value = value; break;
+    }
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, std::string const& value) :
-    _Obj(new Data_t())
-{
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_U._String = new std::string(value);
-    _Obj->_Type = ObjectType::String;
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, std::string && value) :
-    _Obj(new Data_t())
+inline StringView ValveDataViewNode::Name() const
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_U._String = new std::string(std::move(value));
-    _Obj->_Type = ObjectType::String;
+    return _Node->name;
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, int32_t value) :
-    _Obj(new Data_t())
+inline ObjectType ValveDataViewNode::Type() const
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_U._Int32 = value;
-    _Obj->_Type = ObjectType::Int32;
+    return _Node->type;
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, float value) :
-    _Obj(new Data_t())
+inline bool ValveDataViewNode::Empty() const
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_U._Float = value;
-    _Obj->_Type = ObjectType::Float;
+    return _Node->type == ObjectType::None;
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, pointer_t value):
-    _Obj(new Data_t())
+inline StringView ValveDataViewNode::String() const
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_U._Pointer = value;
-    _Obj->_Type = ObjectType::Pointer;
+    return _Node->value.String();
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, color_t value) :
-    _Obj(new Data_t())
+inline StringView ValveDataViewNode::WideString() const
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_U._Color = value;
-    _Obj->_Type = ObjectType::Color;
+    return _Node->value.WideString();
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, int64_t value) :
-    _Obj(new Data_t())
+inline StringView ValveDataViewNode::Binary() const
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_U._Int64 = value;
-    _Obj->_Type = ObjectType::Int64;
+    return _Node->value.Binary();
 }
 
-inline ValveDataObject::ValveDataObject(std::string const& key, uint64_t value) :
-    _Obj(new Data_t())
+inline int32_t ValveDataViewNode::Int32() const
 {
-    _Obj->_Name = key;
-    _Obj->_NameHash = std::hash<std::string>()(key);
-    _Obj->_U._UInt64 = value;
-    _Obj->_Type = ObjectType::UInt64;
+    return _Node->value.Int32();
 }
 
-inline ValveDataObject::~ValveDataObject()
+inline float ValveDataViewNode::Float() const
 {
-    _ResetValue();
-    delete _Obj;
+    return _Node->value.Float();
 }
 
-inline void ValveDataObject::Name(std::string const& value)
+inline pointer_t ValveDataViewNode::Pointer() const
 {
-    _Obj->_NameHash = std::hash<std::string>()(value);
-    _Obj->_Name = value;
+    return _Node->value.Pointer();
 }
 
-inline void ValveDataObject::Name(std::string&& value)
+inline color_t ValveDataViewNode::Color() const
 {
-    _Obj->_NameHash = std::hash<std::string>()(value);
-    _Obj->_Name = std::move(value);
+    return _Node->value.Color();
 }
 
-inline std::string const& ValveDataObject::Name() const
+inline int64_t ValveDataViewNode::Int64() const
 {
-    return _Obj->_Name;
+    return _Node->value.Int64();
 }
 
-inline ObjectType ValveDataObject::Type() const
+inline uint64_t ValveDataViewNode::UInt64() const
 {
-    return _Obj->_Type;
+    return _Node->value.UInt64();
 }
 
-inline bool ValveDataObject::Empty() const
+inline size_t ValveDataViewNode::Size() const
 {
-    return _Obj->_Type == ObjectType::None;
+    return _Node->size;
 }
 
-inline std::string& ValveDataObject::String()
+inline ValveDataViewNode::Iterator ValveDataViewNode::begin() const
 {
-    if (_Obj->_Type != ObjectType::String)
-    {
-        throw std::invalid_argument("Attempted to read a String from a non String type.");
-    }
+    if (_Node->type != ObjectType::Object)
+        throw std::invalid_argument("Attempted to get a Collection from non Collection type.");
 
-    return *_Obj->_U._String;
+    return Iterator(_Node + 1);
 }
 
-inline std::string const& ValveDataObject::String() const
+inline ValveDataViewNode::Iterator ValveDataViewNode::end() const
 {
-    if (_Obj->_Type != ObjectType::String)
-    {
-        throw std::invalid_argument("Attempted to read a String from a non String type.");
-    }
-    
-    return *_Obj->_U._String;
+    return Iterator(_Node + _Node->span);
 }
 
-inline ValveCollection& ValveDataObject::Collection()
+inline std::vector<ValveDataViewNode> ValveDataViewNode::operator[](StringView key) const
 {
-    if (_Obj->_Type != ObjectType::Object)
+    std::vector<ValveDataViewNode> r;
+
+    for (auto item : *this)
     {
-        throw std::invalid_argument("Attempted to get a Collection from non Collection type.");
+        if (item.Name() == key)
+            r.emplace_back(item);
     }
 
-    return *_Obj->_U._Collection;
+    return r;
 }
 
-inline ValveCollection const& ValveDataObject::Collection() const
+inline ValveDataViewNode ValveDataView::Root() const
 {
-    if (_Obj->_Type != ObjectType::Object)
-    {
-        throw std::invalid_argument("Attempted to get a Collection from non Collection type.");
-    }
+    static const Details::ViewNode none = { StringView(), ValveDataValue(), 1, 0, ObjectType::None };
 
-    return *_Obj->_U._Collection;
+    return ValveDataViewNode(_Nodes.empty() ? &none : _Nodes.data());
 }
 
-inline bool ValveDataObject::operator==(std::nullptr_t)
+inline ValveDataView ValveDataView::Parse(const char* data, size_t size, ParseOptions const& options)
 {
-    return Empty();
+    ValveDataView view;
+    Details::ViewBuilder builder(view, data, size);
+
+    ParseWithHandler(data, size, builder, options);
+    return view;
 }
 
-inline ValveDataObject& ValveDataObject::operator=(ValveDataObject const& value)
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//                        ValveDataCursor                          //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+inline ValveDataCursor::ValveDataCursor() :
+    _Data(nullptr),
+    _Size(0),
+    _Type(ObjectType::None),
+    _NameEscaped(false),
+    _StringEscaped(false),
+    _Offset(0),
+    _Line(1)
+{}
+
+inline ValveDataCursor ValveDataCursor::_Child() const
 {
-    std::cout << "Copy" << std::endl;
-    return (*this = ValveDataObject(value));
+    ValveDataCursor child;
+    child._Data = _Data;
+    child._Size = _Size;
+    child._Options = _Options;
+    return child;
 }
 
-inline ValveDataObject& ValveDataObject::operator=(ValveDataObject&& value) noexcept
+inline bool ValveDataCursor::_ReadChild(Details::BufferTextSource& source, ValveDataCursor& child)
 {
-    auto type = value._Obj->_Type;
-    auto v = value._Obj->_U;
-    
-    value._Obj->_Type = _Obj->_Type;
-    value._Obj->_U = _Obj->_U;
+    const char* token_start;
+    const char* token_end;
+    Details::TextToken token;
 
-    _Obj->_Type = type;
-    _Obj->_U = v;
+    token = source.Next(token_start, token_end);
+    if (token == Details::TextToken::End || token == Details::TextToken::ObjectEnd)
+        return false;
 
-    return *this;
+    if (token == Details::TextToken::UnterminatedString)
+    {
+        throw ParserException("Expected item key end at line " + std::to_string(source.Line()));
+    }
+    if (token != Details::TextToken::String && token != Details::TextToken::Data)
+    {
+        throw ParserException("Expected item key start at line " + std::to_string(source.Line()));
+    }
+    child._Name = StringView(token_start, token_end - token_start);
+    child._NameEscaped = child._Options.escape_sequences && source.HasEscape();
+    if (child._NameEscaped)
+        Details::UnescapeString(token_start, token_end, child._NameBuffer);
+
+    token = source.Next(token_start, token_end);
+    switch (token)
+    {
+        case Details::TextToken::String:
+        case Details::TextToken::Data:
+            child._Type = ObjectType::String;
+            child._String = StringView(token_start, token_end - token_start);
+            child._StringEscaped = child._Options.escape_sequences && source.HasEscape();
+            if (child._StringEscaped)
+                Details::UnescapeString(token_start, token_end, child._StringBuffer);
+            return true;
+
+        case Details::TextToken::ObjectStart:
+            child._Type = ObjectType::Object;
+            child._String = StringView();
+            child._StringEscaped = false;
+            child._Offset = token_end - child._Data;
+            child._Line = source.Line();
+            return true;
+
+        case Details::TextToken::End:
+            return false;
+
+        case Details::TextToken::UnterminatedString:
+            throw ParserException("Expected item value end at line " + std::to_string(source.Line()));
+
+        default:
+            throw ParserException("Expected item value start at line " + std::to_string(source.Line()));
+    }
+}
+
+inline StringView ValveDataCursor::Name() const
+{
+    return _NameEscaped ? StringView(_NameBuffer) : _Name;
 }
 
-inline ValveDataObject& ValveDataObject::operator=(std::nullptr_t)
+inline ObjectType ValveDataCursor::Type() const
 {
-    _ResetValue();
-    return *this;
+    return _Type;
 }
 
-inline ValveDataObject& ValveDataObject::operator=(std::string const& value)
+inline bool ValveDataCursor::Empty() const
 {
-    std::string* v = new std::string(value);
-    _ResetValue();
-    _Obj->_U._String = v;
-    _Obj->_Type = ObjectType::String;
-
-    return *this;
+    return _Type == ObjectType::None;
 }
 
-inline ValveDataObject& ValveDataObject::operator=(std::string&& value)
+inline StringView ValveDataCursor::String() const
 {
-    std::string* v = new std::string(std::move(value));
-    _ResetValue();
-    _Obj->_U._String = v;
-    _Obj->_Type = ObjectType::String;
+    if (_Type != ObjectType::String)
+        throw std::invalid_argument("Attempted to read a String from a non String type.");
 
-    return *this;
+    return _StringEscaped ? StringView(_StringBuffer) : _String;
 }
 
-inline ValveDataObject& ValveDataObject::operator=(int32_t value)
+inline ValveDataCursor::Iterator ValveDataCursor::begin() const
 {
-    _ResetValue();
-    _Obj->_U._Int32 = value;
-    _Obj->_Type = ObjectType::Int32;
+    if (_Type != ObjectType::Object)
+        throw std::invalid_argument("Attempted to get a Collection from non Collection type.");
 
-    return *this;
+    return Iterator(*this, false);
 }
 
-inline ValveDataObject& ValveDataObject::operator=(pointer_t value)
+inline ValveDataCursor::Iterator ValveDataCursor::end() const
 {
-    _ResetValue();
-    _Obj->_U._Pointer = value;
-    _Obj->_Type = ObjectType::Int32;
-
-    return *this;
+    return Iterator(*this, true);
 }
 
-inline ValveDataObject& ValveDataObject::operator=(color_t value)
+inline ValveDataCursor ValveDataCursor::Find(StringView key) const
 {
-    _ResetValue();
-    _Obj->_U._Color = value;
-    _Obj->_Type = ObjectType::Int32;
+    if (_Type != ObjectType::Object)
+        throw std::invalid_argument("Attempted to get a Collection from non Collection type.");
 
-    return *this;
-}
+    Details::BufferTextSource source(_Data + _Offset, _Size - _Offset, _Line, _Options.validate_utf8);
+    ValveDataCursor child = _Child();
 
-inline ValveDataObject& ValveDataObject::operator=(float value)
-{
-    _ResetValue();
-    _Obj->_U._Float = value;
-    _Obj->_Type = ObjectType::Float;
+    while (_ReadChild(source, child))
+    {
+        if (child.Name() == key)
+            return child;
 
-    return *this;
+        if (child._Type == ObjectType::Object && !source.SkipObject())
+            break;
+    }
+
+    return ValveDataCursor();
 }
 
-inline ValveDataObject& ValveDataObject::operator=(int64_t value)
+inline std::vector<ValveDataCursor> ValveDataCursor::operator[](StringView key) const
 {
-    _ResetValue();
-    _Obj->_U._Int64 = value;
-    _Obj->_Type = ObjectType::Int64;
+    std::vector<ValveDataCursor> r;
 
-    return *this;
+    for (auto const& item : *this)
+    {
+        if (item.Name() == key)
+            r.emplace_back(item);
+    }
+
+    return r;
 }
 
-inline ValveDataObject& ValveDataObject::operator=(uint64_t value)
+inline ValveDataObject ValveDataCursor::ToObject() const
 {
-    _ResetValue();
-    _Obj->_U._UInt64 = value;
-    _Obj->_Type = ObjectType::UInt64;
+    switch (_Type)
+    {
+        case ObjectType::String:
+            return ValveDataObject(Name().str(), String().str());
 
-    return *this;
+        case ObjectType::Object:
+        {
+            ValveDataObject o;
+            Details::BufferTextSource source(_Data + _Offset, _Size - _Offset, _Line, _Options.validate_utf8);
+            ValveDataObjectBuilder builder(o);
+            builder.OnObjectBegin(Name());
+            uint32_t depth = 1;
+            Details::ParseTextMembers(source, _Options, builder, depth);
+            return o;
+        }
+
+        default:
+            return ValveDataObject();
+    }
 }
 
-inline int32_t ValveDataObject::Int32() const
+inline ValveDataCursor ValveDataCursor::Open(const char* data, size_t size, ParseOptions const& options)
 {
-    if (_Obj->_Type != ObjectType::Int32)
+    const char* token_start;
+    const char* token_end;
+    Details::TextToken token;
+    const char* input = data;
+    size_t input_size = size;
+    Details::BinaryNodeType binary_root_end;
+
+    ValveDataCursor root;
+    root._Data = data;
+    root._Size = size;
+    root._Options = options;
+
+    if (Details::DetectBufferFormat(input, input_size, binary_root_end))
+        throw ParserException("ValveDataCursor only supports text VDF.");
+
+    Details::BufferTextSource source(data, size, 1, options.validate_utf8);
+    token = source.Next(token_start, token_end);
+    if (token == Details::TextToken::End)
+        return root;
+
+    if (token == Details::TextToken::UnterminatedString)
     {
-        throw std::invalid_argument("Attempted to get an Int32 from non Int32 type.");
+        throw ParserException("Expected object key end at line " + std::to_string(source.Line()));
+    }
+    if (token != Details::TextToken::String && token != Details::TextToken::Data)
+    {
+        throw ParserException("Expected object key start at line " + std::to_string(source.Line()));
     }
+    root._Name = StringView(token_start, token_end - token_start);
+    root._NameEscaped = options.escape_sequences && source.HasEscape();
+    if (root._NameEscaped)
+        Details::UnescapeString(token_start, token_end, root._NameBuffer);
 
-    return _Obj->_U._Int32;
+    if (source.Next(token_start, token_end) != Details::TextToken::ObjectStart)
+    {
+        throw ParserException("Expected object start at line " + std::to_string(source.Line()));
+    }
+
+    root._Type = ObjectType::Object;
+    root._Offset = token_end - data;
+    root._Line = source.Line();
+    return root;
 }
 
-inline float ValveDataObject::Float() const
+inline ValveDataCursor::Iterator::Iterator(ValveDataCursor const& parent, bool end) :
+    _Source(parent._Data + parent._Offset, parent._Size - parent._Offset, parent._Line, parent._Options.validate_utf8),
+    _Current(parent._Child()),
+    _End(end)
 {
-    if (_Obj->_Type != ObjectType::Float)
+    if (!_End)
+        _End = !_ReadChild(_Source, _Current);
+}
+
+inline ValveDataCursor::Iterator& ValveDataCursor::Iterator::operator++()
+{
+    if (_Current._Type == ObjectType::Object && !_Source.SkipObject())
     {
-        throw std::invalid_argument("Attempted to get a Float from non Float type.");
+        _End = true;
+        return *this;
     }
 
-    return _Obj->_U._Float;
+    _End = !_ReadChild(_Source, _Current);
+    return *this;
 }
 
-inline pointer_t ValveDataObject::Pointer() const
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//                        ValveDataReader                          //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+inline ValveDataReader::ValveDataReader(std::istream& is, ParseOptions const& options) :
+    _Options(options),
+    _Buffer(options.chunk_size < 8 ? 8 : options.chunk_size, '\0'),
+    _Started(false),
+    _Truncated(false),
+    _Depth(0)
 {
-    if (_Obj->_Type != ObjectType::Pointer)
+    size_t lookahead;
+    _Binary = Details::DetectStreamFormat(is, _Buffer, _BinaryRootEnd, lookahead);
+    if (_Binary)
     {
-        throw std::invalid_argument("Attempted to get a Pointer from non Pointer type.");
+        _BinaryInput.reset(new Details::BinaryInput(is, _Buffer.length(), options.validate_utf8, StringView(_Buffer.data(), lookahead)));
+    }
+    else
+    {
+        _StreamText.reset(new Details::StreamTextSource(is, _Buffer, options.validate_utf8, lookahead));
     }
-
-    return _Obj->_U._Pointer;
 }
 
-inline color_t ValveDataObject::Color() const
+inline ValveDataReader::ValveDataReader(const char* data, size_t size, ParseOptions const& options) :
+    _Options(options),
+    _Started(false),
+    _Truncated(false),
+    _Depth(0)
 {
-    if (_Obj->_Type != ObjectType::Color)
+    _Binary = Details::DetectBufferFormat(data, size, _BinaryRootEnd);
+    if (_Binary)
     {
-        throw std::invalid_argument("Attempted to get a Pointer from non Pointer type.");
+        _BinaryInput.reset(new Details::BinaryInput(data, size, options.validate_utf8));
     }
+    else
+    {
+        _BufferText.reset(new Details::BufferTextSource(data, size, 1, options.validate_utf8));
+    }
+}
 
-    return _Obj->_U._Color;
+inline ValveDataReader::Token ValveDataReader::_Close()
+{
+    _Truncated = true;
+    _Key = StringView();
+    if (_Depth == 0)
+        return Token::End;
+
+    --_Depth;
+    return Token::ObjectEnd;
 }
 
-inline int64_t ValveDataObject::Int64() const
+template<typename TextSource>
+inline ValveDataReader::Token ValveDataReader::_NextText(TextSource& source)
 {
-    if (_Obj->_Type != ObjectType::Int64)
+    const char* token_start;
+    const char* token_end;
+    Details::TextToken token;
+
+    if (!_Started)
     {
-        throw std::invalid_argument("Attempted to get an Int64 from non Int64 type.");
+        _Started = true;
+        token = source.Next(token_start, token_end);
+        if (token == Details::TextToken::End)
+            return Token::End;
+
+        if (token == Details::TextToken::UnterminatedString)
+        {
+            throw ParserException("Expected object key end at line " + std::to_string(source.Line()));
+        }
+        if (token != Details::TextToken::String && token != Details::TextToken::Data)
+        {
+            throw ParserException("Expected object key start at line " + std::to_string(source.Line()));
+        }
+        _Key = Details::ReadTokenString(source, token_start, token_end, _Options.escape_sequences, !TextSource::stable_tokens, _KeyBuffer);
+
+        if (source.Next(token_start, token_end) != Details::TextToken::ObjectStart)
+        {
+            throw ParserException("Expected object start at line " + std::to_string(source.Line()));
+        }
+
+        _Depth = 1;
+        return Token::ObjectBegin;
     }
 
-    return _Obj->_U._Int64;
-}
+    token = source.Next(token_start, token_end);
+    if (token == Details::TextToken::End)
+        return _Close();
 
-inline uint64_t ValveDataObject::UInt64() const
-{
-    if (_Obj->_Type != ObjectType::UInt64)
+    if (token == Details::TextToken::ObjectEnd)
     {
-        throw std::invalid_argument("Attempted to get an UInt64 from non UInt64 type.");
+        _Key = StringView();
+        --_Depth;
+        return Token::ObjectEnd;
     }
 
-    return _Obj->_U._UInt64;
-}
+    if (token == Details::TextToken::UnterminatedString)
+    {
+        throw ParserException("Expected item key end at line " + std::to_string(source.Line()));
+    }
+    if (token != Details::TextToken::String && token != Details::TextToken::Data)
+    {
+        throw ParserException("Expected item key start at line " + std::to_string(source.Line()));
+    }
+    _Key = Details::ReadTokenString(source, token_start, token_end, _Options.escape_sequences, !TextSource::stable_tokens, _KeyBuffer);
 
-inline ValveCollectionRef ValveDataObject::operator[](const char* key)
-{
-    return (*this)[std::string(key)];
+    token = source.Next(token_start, token_end);
+    switch (token)
+    {
+        case Details::TextToken::String:
+        case Details::TextToken::Data:
+            _Value = Details::TextValue(Details::ReadTokenString(source, token_start, token_end, _Options.escape_sequences, false, _ValueBuffer), _Options);
+            return Token::Value;
+
+        case Details::TextToken::ObjectStart:
+            if (_Depth >= _Options.max_depth)
+            {
+                throw ParserException("Maximum nesting depth of " + std::to_string(_Options.max_depth) + " exceeded at line " + std::to_string(source.Line()));
+            }
+            ++_Depth;
+            return Token::ObjectBegin;
+
+        case Details::TextToken::End:
+            return _Close();
+
+        case Details::TextToken::UnterminatedString:
+            throw ParserException("Expected item value end at line " + std::to_string(source.Line()));
+
+        default:
+            throw ParserException("Expected item value start at line " + std::to_string(source.Line()));
+    }
 }
 
-inline ValveCollectionRef ValveDataObject::operator[](std::string const& key)
+inline ValveDataReader::Token ValveDataReader::_NextBinary()
 {
-    auto& c = Collection();
+    Details::BinaryInput& input = *_BinaryInput;
+    Details::BinaryNodeType type;
 
-    ValveCollectionRef r;
-    size_t key_hash = std::hash<std::string>()(key);
+    if (!_Started)
+    {
+        _Started = true;
+        if (!input.Read(&type, sizeof(type)))
+        {
+            throw ParserException("Premature end of file while parsing root binary object");
+        }
+        if (type != Details::BinaryNodeType::Object)
+        {
+            throw ParserException("Binary root item type is not an object");
+        }
+        if (!input.ReadString(_KeyBuffer))
+            return Token::End;
 
-    for (auto& item : c)
+        _Key = StringView(_KeyBuffer);
+        _Depth = 1;
+        return Token::ObjectBegin;
+    }
+
+    if (!input.Read(&type, sizeof(type)))
+        return _Close();
+
+    if (type == Details::BinaryNodeType::ObjectEnd || type == Details::BinaryNodeType::AlternativeEnd)
     {
-        if (item._Obj->_NameHash == key_hash)
-            r.emplace_back(ValveDataObjectRef(&item));
+        _Key = StringView();
+        --_Depth;
+        return Token::ObjectEnd;
     }
 
-    return r;
-}
+    if (!input.ReadString(_KeyBuffer))
+        return _Close();
 
-inline ValveCollectionConstRef ValveDataObject::operator[](const char* key) const
-{
-    return (*this)[std::string(key)];
+    _Key = StringView(_KeyBuffer);
+    switch (type)
+    {
+        case Details::BinaryNodeType::Object:
+            if (_Depth >= _Options.max_depth)
+            {
+                throw ParserException("Maximum nesting depth of " + std::to_string(_Options.max_depth) + " exceeded");
+            }
+            ++_Depth;
+            return Token::ObjectBegin;
+
+        case Details::BinaryNodeType::String:
+            if (!input.ReadString(_ValueBuffer))
+                return _Close();
+
+            _Value = ValveDataValue(StringView(_ValueBuffer));
+            return Token::Value;
+
+        case Details::BinaryNodeType::WideString:
+            if (!input.ReadWideString(_ValueBuffer, _UnitBuffer))
+                return _Close();
+
+            _Value = ValveDataValue(ObjectType::WideString, StringView(_ValueBuffer));
+            return Token::Value;
+
+        case Details::BinaryNodeType::Binary:
+        {
+            uint32_t size;
+            if (!input.Read(&size, sizeof(size)) || !input.ReadBytes(_ValueBuffer, size))
+                return _Close();
+
+            _Value = ValveDataValue(ObjectType::Binary, StringView(_ValueBuffer));
+            return Token::Value;
+        }
+
+        case Details::BinaryNodeType::Int32:
+        {
+            int32_t value;
+            if (!input.Read(&value, sizeof(value)))
+                return _Close();
+
+            _Value = ValveDataValue(value);
+            return Token::Value;
+        }
+
+        case Details::BinaryNodeType::Float:
+        {
+            float value;
+            if (!input.Read(&value, sizeof(value)))
+                return _Close();
+
+            _Value = ValveDataValue(value);
+            return Token::Value;
+        }
+
+        case Details::BinaryNodeType::Pointer:
+        {
+            pointer_t value;
+            if (!input.Read(&value, sizeof(value)))
+                return _Close();
+
+            _Value = ValveDataValue(value);
+            return Token::Value;
+        }
+
+        case Details::BinaryNodeType::Color:
+        {
+            color_t value;
+            if (!input.Read(&value, sizeof(value)))
+                return _Close();
+
+            _Value = ValveDataValue(value);
+            return Token::Value;
+        }
+
+        case Details::BinaryNodeType::Int64:
+        {
+            int64_t value;
+            if (!input.Read(&value, sizeof(value)))
+                return _Close();
+
+            _Value = ValveDataValue(value);
+            return Token::Value;
+        }
+
+        case Details::BinaryNodeType::UInt64:
+        {
+            uint64_t value;
+            if (!input.Read(&value, sizeof(value)))
+                return _Close();
+
+            _Value = ValveDataValue(value);
+            return Token::Value;
+        }
+
+        default:
+            throw ParserException("Unhandled binary item type " + std::to_string((uint32_t)type));
+    }
 }
 
-inline ValveCollectionConstRef ValveDataObject::operator[](std::string const& key) const
+inline ValveDataReader::Token ValveDataReader::Next()
 {
-    auto& c = Collection();
+    if (_Truncated)
+        return _Close();
 
-    ValveCollectionConstRef r;
-    size_t key_hash = std::hash<std::string>()(key);
+    if (_Started && _Depth == 0)
+        return Token::End;
 
-    for (auto& item : c)
-    {
-        if (item._Obj->_NameHash == key_hash)
-            r.emplace_back(ValveDataObjectConstRef(&item));
-    }
+    if (_BufferText)
+        return _NextText(*_BufferText);
 
-    return r;
+    if (_StreamText)
+        return _NextText(*_StreamText);
+
+    return _NextBinary();
 }
 
-inline void ValveDataObject::_ResetValue()
+inline void ValveDataReader::SkipObject()
 {
-    if (_Obj == nullptr)
+    uint32_t depth = _Depth;
+    if (depth == 0 || _Truncated)
         return;
 
-    switch (_Obj->_Type)
+    if (_BufferText || _StreamText)
     {
-        case ObjectType::String: delete _Obj->_U._String; break;
-        case ObjectType::Object: delete _Obj->_U._Collection; break;
-        default: break; // Warning fix.
+        if (_BufferText ? _BufferText->SkipObject() : _StreamText->SkipObject())
+        {
+            --_Depth;
+        }
+        else
+        {
+            _Close();
+        }
     }
-    _Obj->_Type = ObjectType::None;
+    else
+    {
+        while (_Depth >= depth && !_Truncated)
+            _NextBinary();
+    }
+    _Key = StringView();
+}
+
+inline StringView ValveDataReader::Key() const
+{
+    return _Key;
+}
+
+inline ValveDataValue const& ValveDataReader::Value() const
+{
+    return _Value;
 }
 
-inline void ValveDataObject::_ParseTextObject(std::istream& is, std::string& name, std::string& buffer, uint32_t& line_num, ValveDataObject& o)
+inline uint32_t ValveDataReader::Depth() const
 {
-    const char* line_start;
-    const char* line_end;
+    return _Depth;
+}
+
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//                       ValveDataPushParser                       //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+template<typename Handler>
+inline ValveDataPushParser<Handler>::ValveDataPushParser(Handler& handler, ParseOptions const& options) :
+    _Handler(handler),
+    _Options(options),
+    _Format(Format::Unknown),
+    _Scanner(1, options.validate_utf8),
+    _Binary(Details::BinaryNodeType::ObjectEnd, options),
+    _VerifyCrc(false),
+    _Crc(0),
+    _StoredCrc(0),
+    _Step(Step::RootKey),
+    _Depth(0)
+{}
 
-    std::string object_name;
-    std::string tmp;
-    int error;
-    bool is_object = false;
+template<typename Handler>
+inline bool ValveDataPushParser<Handler>::_Detect(bool final)
+{
+    // Enough for the binary header.
+    if (_Buffer.length() < 8 && !final)
+        return false;
 
-    o._Obj->_NameHash = std::hash<std::string>()(name);
-    o._Obj->_Name = std::move(name);
-    o._Obj->_U._Collection = new ValveCollection();
-    o._Obj->_Type = ObjectType::Object;
+    const char* data = _Buffer.data();
+    size_t size = _Buffer.length();
+    Details::BinaryNodeType binary_root_end;
 
-    while (EasyVDF::Details::getline(is, buffer))
+    if (Details::DetectBufferFormat(data, size, binary_root_end, &_StoredCrc))
     {
-        ++line_num;
-        line_start = &buffer[0];
-        line_end = line_start + buffer.length();
-        Details::SkipSpaces(line_start, line_end);
-            
-        // Skip empty line
-        if (line_start == line_end)
-            continue;
-            
-        if (*line_start == '}')
-            break;
+        _Format = Format::Binary;
+        _Binary = Details::BinaryParser(binary_root_end, _Options);
+        _VerifyCrc = _Options.verify_crc && binary_root_end == Details::BinaryNodeType::AlternativeEnd;
+        _ParseBinary(data, size);
+        _Buffer.clear();
+    }
+    else
+    {
+        _Format = Format::Text;
+        _Scanner.Feed(_Buffer.data(), _Buffer.length(), final);
+        _ParseText();
+    }
 
-        if (!is_object)
-        {
-            error = Details::ParseString(line_start, line_end, object_name);
-            if (error == -1)
-            {
-                throw ParserException("Expected item key start at line " + std::to_string(line_num));
-            }
-            if (error == -2)
-            {
-                throw ParserException("Expected item key end at line " + std::to_string(line_num));
-            }
-            if (error == -3)
+    return true;
+}
+
+template<typename Handler>
+inline void ValveDataPushParser<Handler>::_ParseText()
+{
+    size_t start = 0, end = 0;
+    Details::TextToken token;
+
+    while (_Step != Step::Done)
+    {
+        token = _Scanner.Next(start, end);
+        if (token == Details::TextToken::NeedMore)
+            return;
+
+        const char* token_start = _Buffer.data() + start;
+        const char* token_end = _Buffer.data() + end;
+
+        if (token == Details::TextToken::End && _Step != Step::RootStart)
+        {// Premature end of input, close the opened objects.
+            while (_Depth != 0)
             {
-                throw ParserException("Invalid codepoint at line " + std::to_string(line_num));
+                --_Depth;
+                _Handler.OnObjectEnd();
             }
-            Details::SkipSpaces(line_start, line_end);
+            _Step = Step::Done;
+            return;
+        }
+
+        switch (_Step)
+        {
+            case Step::RootKey:
+                if (token == Details::TextToken::UnterminatedString)
+                {
+                    throw ParserException("Expected object key end at line " + std::to_string(_Scanner.Line()));
+                }
+                if (token != Details::TextToken::String && token != Details::TextToken::Data)
+                {
+                    throw ParserException("Expected object key start at line " + std::to_string(_Scanner.Line()));
+                }
+                Details::ReadTokenString(_Scanner, token_start, token_end, _Options.escape_sequences, true, _Key);
+                _Step = Step::RootStart;
+                break;
 
-            if (*line_start == '"')
-            {// Parsing item value
-                error = Details::ParseString(line_start, line_end, tmp);
-                if (error == -1)
+            case Step::RootStart:
+                if (token != Details::TextToken::ObjectStart)
                 {
-                    throw ParserException("Expected item value start at line " + std::to_string(line_num));
+                    throw ParserException("Expected object start at line " + std::to_string(_Scanner.Line()));
                 }
-                if (error == -2)
+                _Handler.OnObjectBegin(StringView(_Key));
+                _Depth = 1;
+                _Step = Step::Key;
+                break;
+
+            case Step::Key:
+                if (token == Details::TextToken::ObjectEnd)
                 {
-                    throw ParserException("Expected item value end at line " + std::to_string(line_num));
+                    _Handler.OnObjectEnd();
+                    if (--_Depth == 0)
+                        _Step = Step::Done;
+
+                    break;
                 }
-                if (error == -3)
+                if (token == Details::TextToken::UnterminatedString)
                 {
-                    throw ParserException("Invalid codepoint at line " + std::to_string(line_num));
+                    throw ParserException("Expected item key end at line " + std::to_string(_Scanner.Line()));
                 }
-                Details::SkipSpaces(line_start, line_end);
-                if (line_start != line_end)
+                if (token != Details::TextToken::String && token != Details::TextToken::Data)
                 {
-                    throw ParserException("Got datas after item value at line " + std::to_string(line_num));
+                    throw ParserException("Expected item key start at line " + std::to_string(_Scanner.Line()));
                 }
+                // The key must survive the chunks up to the value.
+                Details::ReadTokenString(_Scanner, token_start, token_end, _Options.escape_sequences, true, _Key);
+                _Step = Step::Value;
+                break;
 
-                o._Obj->_U._Collection->emplace_back(std::move(object_name), tmp);
-            }
-            else if (line_start != line_end)
-            {
-                throw ParserException("Got datas after item key at line " + std::to_string(line_num));
-            }
-            else
-            {
-                is_object = true;
-            }
-        }
-        else
-        {
-            if (*line_start++ != '{')
-            {
-                throw ParserException("Expected object start at line " + std::to_string(line_num));
-            }
-            Details::SkipSpaces(line_start, line_end);
-            if (line_start != line_end)
-            {
-                throw ParserException("Got datas after object start at line " + std::to_string(line_num));
-            }
+            case Step::Value:
+                switch (token)
+                {
+                    case Details::TextToken::String:
+                    case Details::TextToken::Data:
+                        _Handler.OnValue(StringView(_Key), Details::TextValue(Details::ReadTokenString(_Scanner, token_start, token_end, _Options.escape_sequences, false, _Value), _Options));
+                        break;
+
+                    case Details::TextToken::ObjectStart:
+                        if (_Depth >= _Options.max_depth)
+                        {
+                            throw ParserException("Maximum nesting depth of " + std::to_string(_Options.max_depth) + " exceeded at line " + std::to_string(_Scanner.Line()));
+                        }
+                        _Handler.OnObjectBegin(StringView(_Key));
+                        ++_Depth;
+                        break;
+
+                    case Details::TextToken::UnterminatedString:
+                        throw ParserException("Expected item value end at line " + std::to_string(_Scanner.Line()));
+
+                    default:
+                        throw ParserException("Expected item value start at line " + std::to_string(_Scanner.Line()));
+                }
+                _Step = Step::Key;
+                break;
 
-            o._Obj->_U._Collection->emplace_back();
-            _ParseTextObject(is, object_name, buffer, line_num, *o._Obj->_U._Collection->rbegin());
-            is_object = false;
+            case Step::Done:
+                break;
         }
     }
 }
-    
 
-inline void ValveDataObject::_ParseBinaryObject(std::istream& is, std::string& name, BinaryNodeType object_end, std::string& buffer, const char*& buffer_start, const char*& buffer_end, ValveDataObject& o)
+template<typename Handler>
+inline void ValveDataPushParser<Handler>::_ParseBinary(const char* data, size_t size)
 {
-    int error;
-    std::string tmp1, item_key;
+    if (_Step == Step::Done)
+        return;
+
+    // The binary datas are parsed in place, only the items cut by the chunks are staged.
+    const char* start = data;
+    bool done = _Binary.Parse(data, start + size, _Handler);
+    if (_VerifyCrc)
+        _Crc = Details::Crc32(_Crc, start, data - start);
 
-    BinaryNodeType state = BinaryNodeType::Object;
-    bool parsed_item_key = false;
-    bool type_read = false;
+    if (done)
+    {
+        _Step = Step::Done;
+        if (_VerifyCrc)
+            Details::CheckBinaryCrc(_Crc, _StoredCrc);
+    }
+}
+
+template<typename Handler>
+inline void ValveDataPushParser<Handler>::_FinishBinary()
+{
+    if (_Step == Step::Done)
+        return;
 
-    o._Obj->_NameHash = std::hash<std::string>()(name);
-    o._Obj->_Name = std::move(name);
-    o._Obj->_U._Collection = new ValveCollection();
-    o._Obj->_Type = ObjectType::Object;
+    _Binary.Finish(_Handler);
+    _Step = Step::Done;
+    // The input ended before the root object, the CRC covers datas that are missing.
+    if (_VerifyCrc)
+        Details::CheckBinaryCrc(_Crc, _StoredCrc);
+}
 
-    while (is || buffer_start != buffer_end)
+template<typename Handler>
+inline void ValveDataPushParser<Handler>::Feed(const char* data, size_t size)
+{
+    switch (_Format)
     {
-        while (buffer_start != buffer_end)
+        case Format::Unknown:
+            _Buffer.append(data, size);
+            _Detect(false);
+            break;
+
+        case Format::Text:
         {
-            if (!type_read)
+            if (_Step == Step::Done)
+                return;
+
+            // Only the datas after the last token are kept.
+            size_t discard = _Scanner.Discardable();
+            if (discard != 0)
             {
-                state = (BinaryNodeType)buffer_start[0];
-                ++buffer_start;
-                item_key.clear();
-                type_read = true;
+                _Buffer.erase(0, discard);
+                _Scanner.Discard(discard);
             }
-            else
-            {
-                if (state == BinaryNodeType::ObjectEnd || state == BinaryNodeType::AlternativeEnd)
-                {
-                    if (state != object_end)
-                    {
-                        // Got object end but I didn't expected this value
-                        //SPDLOG_DEBUG("Got object end {:02x} but expected {:02x}", (uint32_t)state, (uint32_t)object_end);
-                    }
-                    
-                    return;
-                }
+            _Buffer.append(data, size);
+            _Scanner.Feed(_Buffer.data(), _Buffer.length(), false);
+            _ParseText();
+            break;
+        }
 
-                if (!parsed_item_key)
-                {
-                    error = Details::ParseBinaryString(buffer_start, buffer_end, item_key);
-                    if (error == -2)
-                    {
-                        throw ParserException("Invalid codepoint while parsing binary string");
-                    }
-                    if (error == 0)
-                    {
-                        parsed_item_key = true;
-                    }
-                }
-                else
-                {
-                    bool clear = false;
+        case Format::Binary:
+            _ParseBinary(data, size);
+            break;
+    }
+}
 
-                    switch (state)
-                    {
-                        case BinaryNodeType::Object:
-                            o._Obj->_U._Collection->emplace_back();
-                            _ParseBinaryObject(is, item_key, object_end, buffer, buffer_start, buffer_end, *o._Obj->_U._Collection->rbegin());
-                            clear = true;
-                            break;
+template<typename Handler>
+inline void ValveDataPushParser<Handler>::Finish()
+{
+    switch (_Format)
+    {
+        case Format::Unknown:
+            _Detect(true);
+            // The whole input was in the detection buffer.
+            if (_Format == Format::Binary)
+                _FinishBinary();
+            break;
 
-                        case BinaryNodeType::String:
-                            error = Details::ParseBinaryString(buffer_start, buffer_end, tmp1);
-                            if (error == -2)
-                            {
-                                throw ParserException("Invalid codepoint while parsing binary string");
-                            }
-                            if(error == 0)
-                            {// String was fully read
-                                o._Obj->_U._Collection->emplace_back(std::move(item_key), std::move(tmp1));
+        case Format::Text:
+            _Scanner.Feed(_Buffer.data(), _Buffer.length(), true);
+            _ParseText();
+            break;
 
-                                clear = true;
-                            }
-                            break;
+        case Format::Binary:
+            _FinishBinary();
+            break;
+    }
+}
 
-                        case BinaryNodeType::Int32:
-                            Details::ReadBinaryBytes(buffer_start, buffer_end, tmp1, 4);
-                            if (tmp1.length() == 4)
-                            {
-                                o._Obj->_U._Collection->emplace_back(std::move(item_key), *reinterpret_cast<const int32_t*>(tmp1.data()));
-                                clear = true;
-                            }
-                            break;
+template<typename Handler>
+inline bool ValveDataPushParser<Handler>::Done() const
+{
+    return _Step == Step::Done;
+}
 
-                        case BinaryNodeType::Float:
-                            Details::ReadBinaryBytes(buffer_start, buffer_end, tmp1, 4);
-                            if (tmp1.length() == 4)
-                            {
-                                o._Obj->_U._Collection->emplace_back(std::move(item_key), *reinterpret_cast<const float*>(tmp1.data()));
-                                clear = true;
-                            }
-                            break;
 
-                        case BinaryNodeType::Pointer:
-                            Details::ReadBinaryBytes(buffer_start, buffer_end, tmp1, 4);
-                            if (tmp1.length() == 4)
-                            {
-                                o._Obj->_U._Collection->emplace_back(std::move(item_key), *reinterpret_cast<const pointer_t*>(tmp1.data()));
-                                clear = true;
-                            }
-                            break;
+/////////////////////////////////////////////////////////////////////
+//                                                                 //
+//                       ValveDataContainer                        //
+//                                                                 //
+/////////////////////////////////////////////////////////////////////
+namespace Details {
 
-                        case BinaryNodeType::Color:
-                            Details::ReadBinaryBytes(buffer_start, buffer_end, tmp1, 4);
-                            if (tmp1.length() == 4)
-                            {
-                                o._Obj->_U._Collection->emplace_back(std::move(item_key), *reinterpret_cast<const color_t*>(tmp1.data()));
-                                clear = true;
-                            }
-                            break;
+static constexpr uint32_t AppInfoMagic27 = 0x07564427;
+static constexpr uint32_t AppInfoMagic28 = 0x07564428;
+static constexpr uint32_t AppInfoMagic29 = 0x07564429;
+static constexpr uint32_t PackageInfoMagic27 = 0x06565527;
+static constexpr uint32_t PackageInfoMagic28 = 0x06565528;
 
-                        case BinaryNodeType::Int64:
-                            Details::ReadBinaryBytes(buffer_start, buffer_end, tmp1, 8);
-                            if (tmp1.length() == 8)
-                            {
-                                o._Obj->_U._Collection->emplace_back(std::move(item_key), *reinterpret_cast<const int64_t*>(tmp1.data()));
-                                clear = true;
-                            }
-                            break;
+/// <summary>
+/// SHA-1 (FIPS 180-4) of the container entries.
+/// </summary>
+class Sha1
+{
+    uint32_t _State[5];
+    uint8_t _Block[64];
+    size_t _BlockSize;
+    uint64_t _Length;
 
-                        case BinaryNodeType::UInt64:
-                            Details::ReadBinaryBytes(buffer_start, buffer_end, tmp1, 8);
-                            if (tmp1.length() == 8)
-                            {
-                                o._Obj->_U._Collection->emplace_back(std::move(item_key), *reinterpret_cast<const uint64_t*>(tmp1.data()));
-                                clear = true;
-                            }
-                            break;
+    static inline uint32_t _Rotate(uint32_t value, int count)
+    {
+        return (value << count) | (value >> (32 - count));
+    }
 
-                        default:
-                            //SPDLOG_DEBUG("Unhandled item type {:02x}", (uint32_t)state);
-                            throw std::runtime_error("Unhandled VDF type");
-                    }
+    inline void _Transform(const uint8_t* block)
+    {
+        uint32_t w[16];
+        for (int i = 0; i < 16; ++i)
+            w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) | ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
 
-                    if (clear)
-                    {
-                        item_key.clear();
-                        tmp1.clear();
-                        parsed_item_key = false;
-                        type_read = false;
-                    }
-                }
-            }
+        uint32_t a = _State[0], b = _State[1], c = _State[2], d = _State[3], e = _State[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            if (i >= 16)
+                w[i & 15] = _Rotate(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+
+            uint32_t f;
+            if (i < 20)
+                f = ((b & c) | (~b & d)) + 0x5a827999;
+            else if (i < 40)
+                f = (b ^ c ^ d) + 0x6ed9eba1;
+            else if (i < 60)
+                f = ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;
+            else
+                f = (b ^ c ^ d) + 0xca62c1d6;
+
+            uint32_t t = _Rotate(a, 5) + f + e + w[i & 15];
+            e = d;
+            d = c;
+            c = _Rotate(b, 30);
+            b = a;
+            a = t;
         }
 
-        is.read(&buffer[0], buffer.length());
-        buffer_start = &buffer[0];
-        buffer_end = buffer_start + is.gcount();
+        _State[0] += a;
+        _State[1] += b;
+        _State[2] += c;
+        _State[3] += d;
+        _State[4] += e;
     }
-}
 
-inline void ValveDataObject::_SerializeAsText(std::ostream& os, size_t depth) const
-{
-    std::string indent(depth, '\t');
+public:
+    Sha1() :
+        _State{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 },
+        _BlockSize(0),
+        _Length(0)
+    {}
 
-    os << indent << '"' << _Obj->_Name << '"';
-    switch (_Obj->_Type)
+    inline void Update(const void* data, size_t size)
     {
-        case ObjectType::Object:
-            os << '\n' << indent << "{\n";
-            for (auto const& item : *_Obj->_U._Collection)
-            {
-                item._SerializeAsText(os, depth + 1);
-            }
-            os << indent << "}\n";
-            break;
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        _Length += size;
 
-        case ObjectType::Pointer: os << "\t\t\"" << _Obj->_U._Pointer.value << "\"\n"; break;
-        case ObjectType::Color  : os << "\t\t\"" << _Obj->_U._Color.value   << "\"\n"; break;
-        case ObjectType::Float  : os << "\t\t\"" << _Obj->_U._Float         << "\"\n"; break;
-        case ObjectType::Int32  : os << "\t\t\"" << _Obj->_U._Int32         << "\"\n"; break;
-        case ObjectType::Int64  : os << "\t\t\"" << _Obj->_U._Int64         << "\"\n"; break;
-        case ObjectType::UInt64 : os << "\t\t\"" << _Obj->_U._UInt64        << "\"\n"; break;
-        case ObjectType::String : os << "\t\t\"" << *_Obj->_U._String       << "\"\n"; break;
-        
-        //case ObjectType::WideString: TODO;
-        //case ObjectType::Binary    : TODO;
-        
-        case ObjectType::None: break; // Warning fix.
-    }
-}
+        if (_BlockSize != 0)
+        {
+            size_t count = 64 - _BlockSize < size ? 64 - _BlockSize : size;
+            memcpy(_Block + _BlockSize, p, count);
+            _BlockSize += count;
+            p += count;
+            size -= count;
+            if (_BlockSize != 64)
+                return;
+
+            _Transform(_Block);
+            _BlockSize = 0;
+        }
+        for (; size >= 64; p += 64, size -= 64)
+            _Transform(p);
 
-inline void ValveDataObject::_SerializeAsBinary(std::ostream& os, BinaryNodeType object_end, uint32_t crc) const
-{
-    os.write((const char*)&_Obj->_Type, 1);
-    os.write(_Obj->_Name.c_str(), _Obj->_Name.length() + 1);
+        if (size != 0)
+            memcpy(_Block, p, size);
 
-    switch (_Obj->_Type)
+        _BlockSize = size;
+    }
+
+    inline void Final(uint8_t digest[20])
     {
-        case ObjectType::Object:
-            for (auto const& item : *_Obj->_U._Collection)
-            {
-                item._SerializeAsBinary(os, object_end, crc);
-            }
-            os.write((const char*)&object_end, 1);
-            break;
-    
-        case ObjectType::Pointer: os.write((const char*)&_Obj->_U._Pointer, 4); break;
-        case ObjectType::Color  : os.write((const char*)&_Obj->_U._Color, 4); break;
-        case ObjectType::Float  : os.write((const char*)&_Obj->_U._Float, 4); break;
-        case ObjectType::Int32  : os.write((const char*)&_Obj->_U._Int32, 4); break;
-        case ObjectType::Int64  : os.write((const char*)&_Obj->_U._Int64, 8); break;
-        case ObjectType::UInt64 : os.write((const char*)&_Obj->_U._UInt64, 8); break;
-        case ObjectType::String : os.write(_Obj->_U._String->c_str(), _Obj->_U._String->length() + 1); break;
-        
-        //case ObjectType::WideString: TODO;
-        //case ObjectType::Binary    : TODO;
-        
-        case ObjectType::None: break; // Warning fix.
+        uint64_t bits = _Length * 8;
+        uint8_t padding[72] = { 0x80 };
+        size_t padding_size = (_BlockSize < 56 ? 56 : 120) - _BlockSize;
+        for (int i = 0; i < 8; ++i)
+            padding[padding_size + i] = (uint8_t)(bits >> (56 - i * 8));
+
+        Update(padding, padding_size + 8);
+        for (int i = 0; i < 20; ++i)
+            digest[i] = (uint8_t)(_State[i / 4] >> (24 - (i % 4) * 8));
     }
+};
+
+// Reads a little endian field of a container, returns false on premature end of input.
+template<typename T>
+inline bool ReadContainerField(const char*& p, const char* e, T& value)
+{
+    if ((size_t)(e - p) < sizeof(value))
+        return false;
+
+    memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return true;
 }
 
-inline std::string ValveDataObject::SerializeAsBinary(int version) const
+}
+
+inline ValveDataContainer::ValveDataContainer() :
+    _Data(nullptr),
+    _Size(0),
+    _Format(Format::AppInfo),
+    _Version(0),
+    _Universe(0)
+{}
+
+inline ValveDataContainer::Format ValveDataContainer::ContainerFormat() const
 {
-    std::stringstream sstr;
-    SerializeAsBinary(sstr, version);
-    return sstr.str();
+    return _Format;
 }
 
-inline void ValveDataObject::SerializeAsBinary(std::ostream& os, int version) const
+inline uint32_t ValveDataContainer::Version() const
 {
-    if (_Obj->_Type != ObjectType::Object)
-        throw SerializeException("Can't serialize ValveDataObject, it needs to be an Object type.");
+    return _Version;
+}
+
+inline uint32_t ValveDataContainer::Universe() const
+{
+    return _Universe;
+}
 
-    uint32_t crc = 0x00000000;
-    //size_t spos = os.tellp();
+inline std::vector<ValveDataContainer::Entry> const& ValveDataContainer::Entries() const
+{
+    return _Entries;
+}
 
-    BinaryNodeType object_end = version <= 1 ? BinaryNodeType::ObjectEnd : BinaryNodeType::AlternativeEnd;
-    if (version > 1)
+inline ValveDataContainer::Entry const* ValveDataContainer::Find(uint32_t id) const
+{
+    auto it = std::lower_bound(_ById.begin(), _ById.end(), id, [this](uint32_t index, uint32_t id)
     {
-        os.write((const char*)&BinaryVDFMagic, 4);
-        os.write((const char*)&crc, 4);
-    }
+        return _Entries[index].id < id;
+    });
+
+    if (it == _ById.end() || _Entries[*it].id != id)
+        return nullptr;
 
-    _SerializeAsBinary(os, object_end, crc);
+    return &_Entries[*it];
+}
 
-    if (version > 1)
-    {// TODO: Update crc
-        //os.seekp(spos + 4, std::ios::beg);
-        //os.write((const char*)&crc, sizeof(crc));
-        //os.seekp(spos, std::ios::beg);
+template<typename Handler>
+inline void ValveDataContainer::ParseWithHandler(Entry const& entry, Handler& handler, ParseOptions const& options) const
+{
+    const char* b = _Data + entry.offset;
+    if (_Version >= 29)
+    {
+        Details::ParseBinaryBuffer(b, b + entry.size, options, handler, _Keys);
+    }
+    else
+    {
+        Details::ParseBinaryBuffer(b, b + entry.size, options, handler);
     }
 }
 
-inline std::string ValveDataObject::SerializeAsText() const
+inline ValveDataObject ValveDataContainer::Parse(Entry const& entry, ParseOptions const& options) const
 {
-    std::stringstream sstr;
-    SerializeAsText(sstr);
-    return sstr.str();
+    ValveDataObject parsed_object;
+    ValveDataObjectBuilder builder(parsed_object);
+
+    ParseWithHandler(entry, builder, options);
+    return parsed_object;
 }
 
-inline void ValveDataObject::SerializeAsText(std::ostream& os) const
+inline ValveDataObject ValveDataContainer::Parse(uint32_t id, ParseOptions const& options) const
 {
-    if (_Obj->_Type != ObjectType::Object)
-        throw SerializeException("Can't serialize ValveDataObject, it needs to be an Object type.");
+    Entry const* entry = Find(id);
+    if (entry == nullptr)
+    {
+        throw ParserException("No entry with id " + std::to_string(id));
+    }
 
-    _SerializeAsText(os, 0);
+    return Parse(*entry, options);
 }
 
-inline ValveDataObject ValveDataObject::ParseObject(std::istream& is, size_t chunk_size)
+inline bool ValveDataContainer::Verify(Entry const& entry) const
 {
-    uint32_t line_num = 0;
+    if (_Format != Format::AppInfo || _Version < 28)
+        return true;
+
+    uint8_t digest[20];
+    Details::Sha1 sha1;
+    sha1.Update(_Data + entry.offset, entry.size);
+    sha1.Final(digest);
+    return memcmp(digest, entry.binary_sha1, sizeof(digest)) == 0;
+}
 
-    bool as_binary = false;
-    const char* buffer_start, *buffer_end;
+inline std::map<uint32_t, ValveDataObject> ValveDataContainer::ParseAll(ParseOptions const& options, bool verify_checksums) const
+{
+    size_t thread_count = options.threads == 0 ? std::thread::hardware_concurrency() : options.threads;
+    std::vector<ValveDataObject> objects(_Entries.size());
 
-    ValveDataObject parsed_object;
+    Details::ParallelFor(_Entries.size(), thread_count, [&](size_t i)
+    {
+        Entry const& entry = _Entries[i];
+        if (verify_checksums && !Verify(entry))
+        {
+            throw ParserException("SHA-1 mismatch of container entry " + std::to_string(entry.id));
+        }
+        // Built in place, a move assignment only swaps the value and not the root name.
+        ValveDataObjectBuilder builder(objects[i]);
+        ParseWithHandler(entry, builder, options);
+    });
 
-    std::string buffer(chunk_size, '\0');
-    std::string object_name;
-    int error;
-    BinaryNodeType binary_root_end = BinaryNodeType::ObjectEnd;
+    std::map<uint32_t, ValveDataObject> result;
+    for (size_t i = 0; i < objects.size(); ++i)
+        result.emplace(_Entries[i].id, std::move(objects[i]));
 
-    is.read(&buffer[0], 4);
-    if (!is)
-        throw ParserException("Failed to read stream.");
+    return result;
+}
 
-    if (*reinterpret_cast<const uint32_t*>(buffer.data()) == BinaryVDFMagic)
+inline ValveDataContainer ValveDataContainer::Open(const char* data, size_t size)
+{
+    ValveDataContainer container;
+    container._Data = data;
+    container._Size = size;
+
+    const char* p = data;
+    const char* end = data + size;
+    uint32_t magic;
+    if (!Details::ReadContainerField(p, end, magic) || !Details::ReadContainerField(p, end, container._Universe))
     {
-        as_binary = true;
-        binary_root_end = BinaryNodeType::AlternativeEnd;
-        // Skip crc
-        is.seekg(4, std::ios::cur);
+        throw ParserException("Premature end of file while reading container header");
     }
-    else
-    {
-        if (buffer[0] == '\0')
-        {// Likely, This is the root object as binary
-            as_binary = true;
-        }
 
-        is.seekg(0, std::ios::beg);
+    switch (magic)
+    {
+        case Details::AppInfoMagic27    : container._Format = Format::AppInfo; container._Version = 27; break;
+        case Details::AppInfoMagic28    : container._Format = Format::AppInfo; container._Version = 28; break;
+        case Details::AppInfoMagic29    : container._Format = Format::AppInfo; container._Version = 29; break;
+        case Details::PackageInfoMagic27: container._Format = Format::PackageInfo; container._Version = 27; break;
+        case Details::PackageInfoMagic28: container._Format = Format::PackageInfo; container._Version = 28; break;
+
+        default:
+            throw ParserException("Unknown container magic");
     }
 
-    if (!as_binary)
-    {// Parse as text VDF
-        while (EasyVDF::Details::getline(is, buffer))
+    if (container._Version >= 29)
+    {// The string table is after the entries
+        int64_t table_offset;
+        if (!Details::ReadContainerField(p, end, table_offset) || table_offset < p - data || (uint64_t)table_offset > size)
         {
-            ++line_num;
-            buffer_start = &buffer[0];
-            buffer_end = buffer_start + buffer.length();
-            Details::SkipSpaces(buffer_start, buffer_end);
+            throw ParserException("Invalid string table offset");
+        }
 
-            // Skip empty line
-            if (buffer_start == buffer_end)
-                continue;
+        const char* table = data + table_offset;
+        uint32_t count;
+        if (!Details::ReadContainerField(table, end, count))
+        {
+            throw ParserException("Premature end of file while reading string table");
+        }
 
-            if (object_name.empty())
-            {
-                error = Details::ParseString(buffer_start, buffer_end, object_name);
-                if (error == -1)
-                {
-                    throw ParserException("Expected object key start at line " + std::to_string(line_num));
-                }
-                if (error == -2)
-                {
-                    throw ParserException("Expected object key end at line " + std::to_string(line_num));
-                }
-                if (error == -3)
-                {
-                    throw ParserException("Invalid codepoint at line " + std::to_string(line_num));
-                }
-                Details::SkipSpaces(buffer_start, buffer_end);
-                if (buffer_start != buffer_end)
-                {
-                    throw ParserException("Got datas after object key at line " + std::to_string(line_num));
-                }
-            }
-            else
+        container._Keys.keys.reserve(count < (size_t)(end - table) ? count : (size_t)(end - table));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            StringView key;
+            if (!Details::ReadBinaryString(table, end, false, key))
             {
-                if (*buffer_start++ != '{')
-                {
-                    throw ParserException("Expected object start at line " + std::to_string(line_num));
-                }
-                Details::SkipSpaces(buffer_start, buffer_end);
-                if (buffer_start != buffer_end)
-                {
-                    throw ParserException("Got datas after object start at line " + std::to_string(line_num));
-                }
-
-                _ParseTextObject(is, object_name, buffer, line_num, parsed_object);
+                throw ParserException("Premature end of file while reading string table");
             }
+            container._Keys.keys.emplace_back(key);
         }
+        end = data + table_offset;
     }
-    else
-    {// Parse as binary VDF
-        if (!is.read(&buffer[0], 1) || is.gcount() != 1)
-        {
-            throw ParserException("Premature end of file while parsing root binary object");
-        }
-        if (buffer[0] != (int8_t)BinaryNodeType::Object)
+
+    for (;;)
+    {
+        Entry entry = {};
+        if (!Details::ReadContainerField(p, end, entry.id))
         {
-            throw ParserException("Binary root item type is not an object");
+            throw ParserException("Premature end of file while reading container entries");
         }
 
-        while (is.read(&buffer[0], chunk_size) || is.gcount() != 0)
+        const char* entry_start = p;
+        bool complete;
+        if (container._Format == Format::AppInfo)
         {
-            buffer_start = &buffer[0];
-            buffer_end = buffer_start + is.gcount();
+            if (entry.id == 0)
+                break;
 
-            error = Details::ParseBinaryString(buffer_start, buffer_end, object_name);
-            if (error == -2)
+            uint32_t entry_size;
+            complete = Details::ReadContainerField(p, end, entry_size) && (size_t)(end - p) >= entry_size;
+            if (complete)
             {
-                throw ParserException("Invalid codepoint while parsing binary string");
-            }
-            if (error == 0)
-            {
-                _ParseBinaryObject(is, object_name, binary_root_end, buffer, buffer_start, buffer_end, parsed_object);
+                const char* entry_end = p + entry_size;
+                complete =
+                    Details::ReadContainerField(p, entry_end, entry.info_state) &&
+                    Details::ReadContainerField(p, entry_end, entry.last_updated) &&
+                    Details::ReadContainerField(p, entry_end, entry.pics_token) &&
+                    Details::ReadContainerField(p, entry_end, entry.sha1) &&
+                    Details::ReadContainerField(p, entry_end, entry.change_number) &&
+                    (container._Version < 28 || Details::ReadContainerField(p, entry_end, entry.binary_sha1));
+
+                entry.offset = p - data;
+                entry.size = entry_end - p;
+                p = entry_end;
             }
         }
+        else
+        {
+            if (entry.id == 0xffffffff)
+                break;
+
+            complete =
+                Details::ReadContainerField(p, end, entry.sha1) &&
+                Details::ReadContainerField(p, end, entry.change_number) &&
+                (container._Version < 28 || Details::ReadContainerField(p, end, entry.pics_token));
+
+            // No size, the binary VDF is walked to find its end.
+            entry.offset = p - data;
+            complete = complete && Details::SkipBinaryDocument(p, end);
+            entry.size = (p - data) - entry.offset;
+        }
+
+        if (!complete)
+        {
+            throw ParserException("Premature end of file while reading container entry " + std::to_string(entry.id) + " at offset " + std::to_string(entry_start - data - 4));
+        }
+        container._Entries.emplace_back(entry);
     }
 
-    return parsed_object;
+    container._ById.resize(container._Entries.size());
+    for (uint32_t i = 0; i < (uint32_t)container._ById.size(); ++i)
+        container._ById[i] = i;
+
+    std::stable_sort(container._ById.begin(), container._ById.end(), [&container](uint32_t a, uint32_t b)
+    {
+        return container._Entries[a].id < container._Entries[b].id;
+    });
+
+    return container;
 }
 
 }
@@ -141,6 +141,1164 @@ TEST_CASE("Parse binary VDF", "[parse_binary_vdf]")
     CHECK(o["ColorKey"][0].Color().value == EasyVDF::color_t{0x99887766}.value);
     CHECK(o["UInt64Key"][0].UInt64() == 0xfedcba9876543210ull);
     CHECK(o["Int64Key"][0].Int64() == -99999999999991337);
+
+    // Same tree from memory, the view strings point into the buffer
+    std::string binary = o.SerializeAsBinary();
+    CHECK(EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length()).SerializeAsBinary() == binary);
+
+    auto view = EasyVDF::ValveDataView::Parse(binary.data(), binary.length());
+    auto str = view.Root()["StringKey"][0].String();
+    CHECK(str == "StringValue");
+    CHECK((str.data() > binary.data() && str.data() < binary.data() + binary.length()));
+
+    // Premature end closes the opened objects
+    binary.resize(binary.find("StringValue"));
+    EasyVDF::ValveDataObject truncated = EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length());
+    CHECK(truncated["ObjectKey"].size() == 1);
+    CHECK(truncated["StringKey"].size() == 0);
+}
+
+TEST_CASE("Parse binary VDF wide strings and blobs", "[parse_binary_wide_blob]")
+{
+    // "Wide" is UTF-16LE, "Blob" is a size then the bytes.
+    const std::string wide_text = "Long enough ASCII for the vector path, h\xc3\xa9llo \xe2\x82\xac \xf0\x9d\x84\x9e!";
+    std::string units;
+    REQUIRE(EasyVDF::Details::Utf8ToUtf16(wide_text, units));
+    REQUIRE(units.length() == 2 * 50);
+
+    std::string back;
+    REQUIRE(EasyVDF::Details::Utf16ToUtf8(units.data(), units.length() / 2, back));
+    CHECK(back == wide_text);
+    CHECK_FALSE(EasyVDF::Details::Utf8ToUtf16("\xc3", units));
+
+    const std::string blob("\x00\x01\xff\x00\x7f", 5);
+    std::string binary("\x00Root\x00", 6);
+    binary += std::string("\x05Wide\x00", 6);
+    EasyVDF::Details::Utf8ToUtf16(wide_text, binary);
+    binary += std::string("\x00\x00", 2);
+    binary += std::string("\x09" "Blob\x00" "\x05\x00\x00\x00", 10) + blob;
+    binary += '\x08';
+
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length());
+    REQUIRE(o["Wide"].size() == 1);
+    CHECK(o["Wide"][0].Type() == EasyVDF::ObjectType::WideString);
+    CHECK(o["Wide"][0].WideString() == wide_text);
+    CHECK(o["Blob"][0].Type() == EasyVDF::ObjectType::Binary);
+    CHECK(o["Blob"][0].Binary() == blob);
+    CHECK(o.SerializeAsBinary(1) == binary);
+    CHECK(o.SerializeAsText().find("\"0001ff007f\"") != std::string::npos);
+
+    for (size_t chunk_size = 1; chunk_size < 8; ++chunk_size)
+    {
+        std::stringstream sstr(binary);
+        CHECK(EasyVDF::ValveDataObject::ParseObject(sstr, chunk_size).SerializeAsBinary(1) == binary);
+
+        EasyVDF::ValveDataObject pushed;
+        EasyVDF::ValveDataObjectBuilder builder(pushed);
+        EasyVDF::ValveDataPushParser<EasyVDF::ValveDataObjectBuilder> parser(builder);
+        for (size_t i = 0; i < binary.length(); i += chunk_size)
+            parser.Feed(binary.data() + i, std::min(chunk_size, binary.length() - i));
+
+        parser.Finish();
+        CHECK(pushed.SerializeAsBinary(1) == binary);
+    }
+
+    // The blob of a view points into the input
+    auto view = EasyVDF::ValveDataView::Parse(binary.data(), binary.length());
+    auto bytes = view.Root()["Blob"][0].Binary();
+    CHECK(bytes == EasyVDF::StringView(blob));
+    CHECK((bytes.data() > binary.data() && bytes.data() < binary.data() + binary.length()));
+    CHECK(view.Root()["Wide"][0].WideString() == EasyVDF::StringView(wide_text));
+
+    std::stringstream stream(binary);
+    EasyVDF::ValveDataReader reader(stream, EasyVDF::ParseOptions());
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::ObjectBegin);
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::Value);
+    CHECK(reader.Value().WideString() == EasyVDF::StringView(wide_text));
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::Value);
+    CHECK(reader.Value().Binary() == EasyVDF::StringView(blob));
+
+    // Unpaired surrogate
+    std::string invalid("\x00Root\x00\x05Wide\x00\x3d\xd8\x41\x00\x00\x00\x08", 18);
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(invalid.data(), invalid.length()), EasyVDF::ParserException);
+
+    EasyVDF::ValveDataObject invalid_text("Root");
+    invalid_text.Collection().emplace_back("Wide", EasyVDF::wide_string_t{ "\xff" });
+    CHECK_THROWS_AS(invalid_text.SerializeAsBinary(), EasyVDF::SerializeException);
+}
+
+TEST_CASE("Parse VDF from buffer", "[parse_vdf_buffer]")
+{
+    const char* files[] = { "linux_eol.vdf", "macos_eol.vdf", "windows_eol.vdf", "binary.vdf" };
+
+    for (auto file : files)
+    {
+        std::ifstream f(file, std::ios::binary | std::ios::in);
+        std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+        f.clear();
+        f.seekg(0, std::ios::beg);
+
+        EasyVDF::ValveDataObject from_stream = EasyVDF::ValveDataObject::ParseObject(f);
+        EasyVDF::ValveDataObject from_buffer = EasyVDF::ValveDataObject::ParseObject(data.data(), data.length());
+
+        INFO(file);
+        CHECK(from_buffer.Name() == from_stream.Name());
+        CHECK(from_buffer.SerializeAsBinary() == from_stream.SerializeAsBinary());
+    }
+
+    // Last line without EOL and blank lines
+    std::string text = "\"Root\"\n\n{\n\t\"Key\"\t\"Value\"\n\n}";
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length());
+    CHECK(o.Name() == "Root");
+    CHECK(o["Key"][0].String() == "Value");
+}
+
+TEST_CASE("Parse VDF buffer with structural characters in strings", "[parse_vdf_structural_index]")
+{
+    // Make the strings cross the 64 bytes blocks
+    std::string padding(60, ' ');
+    std::string text = "\"Root\"\r\n{\r\n" + padding + "\"Key {with} braces\"\t\"Value \\\"quoted\\\" \\\\\"\r\n" + padding + "\"Empty\"\t\"\"\r\n}\r\n";
+
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length());
+    REQUIRE(o["Key {with} braces"].size() == 1);
+    CHECK(o["Key {with} braces"][0].String() == "Value \"quoted\" \\");
+    CHECK(o["Empty"][0].String() == "");
+
+    std::string bad = "\"Root\"\n{\n\t\"Key\"\t\"Value\" \"Extra\"\n}\n";
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(bad.data(), bad.length()), EasyVDF::ParserException);
+}
+
+TEST_CASE("Parse VDF with any whitespace layout", "[parse_vdf_layout]")
+{
+    const char* layouts[] = {
+        "\"999999\" { \"ObjectKey\" { \"ObjectEntry\" \"ObjectEntryValue\" } \"Version\" \"8\" }",
+        "\"999999\"{\"ObjectKey\"{\"ObjectEntry\"\"ObjectEntryValue\"}\"Version\"\"8\"}",
+        "\"999999\"\n{\n\t\"ObjectKey\" {\n\t\t\"ObjectEntry\"\n\t\t\"ObjectEntryValue\"\n\t} \"Version\" \"8\"\n}\n",
+        "999999 { ObjectKey { ObjectEntry ObjectEntryValue } Version 8 }",
+    };
+
+    std::ifstream f(NATIVE_VDF, std::ios::binary | std::ios::in);
+    EasyVDF::ValveDataObject reference = EasyVDF::ValveDataObject::ParseObject(f);
+
+    for (auto layout : layouts)
+    {
+        INFO(layout);
+
+        EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(layout, strlen(layout));
+        CHECK(o.SerializeAsText() == reference.SerializeAsText());
+
+        for (size_t chunk_size = 1; chunk_size < 20; ++chunk_size)
+        {
+            std::stringstream sstr(layout);
+            CHECK(EasyVDF::ValveDataObject::ParseObject(sstr, chunk_size).SerializeAsText() == reference.SerializeAsText());
+        }
+    }
+}
+
+TEST_CASE("Parse deeply nested VDF", "[parse_vdf_depth]")
+{
+    auto make_text = [](size_t depth) {
+        std::string text;
+        for (size_t i = 0; i < depth; ++i)
+            text += "\"a\"{";
+        text += "\"k\"\"v\"";
+        text += std::string(depth, '}');
+        return text;
+    };
+    auto make_binary = [](size_t depth) {
+        std::string data;
+        for (size_t i = 0; i < depth; ++i)
+            data += std::string("\x00" "a\x00", 3);
+        data += std::string("\x01" "k\x00" "v\x00", 5);
+        data += std::string(depth, '\x08');
+        return data;
+    };
+
+    EasyVDF::ParseOptions options;
+    options.max_depth = 512;
+
+    std::string text = make_text(512);
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+    const EasyVDF::ValveDataObject* item = &o;
+    for (size_t i = 1; i < 512; ++i)
+        item = &item->Collection()[0];
+    CHECK(item->Collection()[0].String() == "v");
+
+    std::string binary = make_binary(512);
+    CHECK_NOTHROW(EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length(), options));
+
+    text = make_text(1000000);
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options), EasyVDF::ParserException);
+    binary = make_binary(1000000);
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length(), options), EasyVDF::ParserException);
+}
+
+TEST_CASE("Parse VDF escape sequences", "[parse_vdf_escape_sequences]")
+{
+    std::string text = "\"Root\" { \"Path\" \"C:\\\\Steam\\\\steamapps\" \"Multi\\tLine\\n\" \"Unknown \\x\" \"Plain\" \"No escape\" }";
+
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length());
+    CHECK(o["Path"][0].String() == "C:\\Steam\\steamapps");
+    CHECK(o["Multi\tLine\n"][0].String() == "Unknown \\x");
+    CHECK(o["Plain"][0].String() == "No escape");
+
+    // Serialized strings are escaped back
+    std::string serialized = o.SerializeAsText();
+    CHECK(serialized.find("\"C:\\\\Steam\\\\steamapps\"") != std::string::npos);
+    EasyVDF::ValveDataObject o2 = EasyVDF::ValveDataObject::ParseObject(serialized.data(), serialized.length());
+    CHECK(o2.SerializeAsBinary() == o.SerializeAsBinary());
+
+    EasyVDF::ParseOptions options;
+    options.escape_sequences = false;
+    o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+    CHECK(o["Path"][0].String() == "C:\\\\Steam\\\\steamapps");
+
+    // Serialized back as is, the round trip keeps the backslashes
+    serialized = o.SerializeAsText(false);
+    CHECK(serialized.find("\"C:\\\\Steam\\\\steamapps\"") != std::string::npos);
+    o2 = EasyVDF::ValveDataObject::ParseObject(serialized.data(), serialized.length(), options);
+    CHECK(o2.SerializeAsText(false) == serialized);
+
+    EasyVDF::ValveDataObject quoted("Root");
+    quoted.Collection().emplace_back("Key", std::string("a\"b"));
+    CHECK_THROWS_AS(quoted.SerializeAsText(false), EasyVDF::SerializeException);
+    quoted["Key"][0].String() = "a\\";
+    CHECK_THROWS_AS(quoted.SerializeAsText(false), EasyVDF::SerializeException);
+}
+
+TEST_CASE("Parse VDF stream with small blocks", "[parse_vdf_small_blocks]")
+{
+    const char* files[] = { "linux_eol.vdf", "macos_eol.vdf", "windows_eol.vdf", "binary.vdf" };
+
+    for (auto file : files)
+    {
+        std::ifstream f(file, std::ios::binary | std::ios::in);
+        EasyVDF::ValveDataObject reference = EasyVDF::ValveDataObject::ParseObject(f);
+
+        for (size_t chunk_size = 1; chunk_size < 20; ++chunk_size)
+        {
+            f.clear();
+            f.seekg(0, std::ios::beg);
+
+            EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(f, chunk_size);
+
+            INFO(file << " with chunk size " << chunk_size);
+            CHECK(o.SerializeAsBinary() == reference.SerializeAsBinary());
+        }
+    }
+}
+
+// Stream that can only be read forward, like a pipe: seeking fails.
+class ForwardOnlyBuffer : public std::streambuf
+{
+    std::string _Data;
+    size_t _Position;
+    size_t _BlockSize;
+
+protected:
+    int_type underflow() override
+    {
+        if (_Position == _Data.length())
+            return traits_type::eof();
+
+        char* block = &_Data[_Position];
+        _Position += std::min(_BlockSize, _Data.length() - _Position);
+        setg(block, block, &_Data[0] + _Position);
+        return traits_type::to_int_type(*block);
+    }
+
+public:
+    ForwardOnlyBuffer(std::string data, size_t block_size) :
+        _Data(std::move(data)),
+        _Position(0),
+        _BlockSize(block_size)
+    {}
+};
+
+TEST_CASE("Parse VDF from a forward-only stream", "[parse_vdf_pipe]")
+{
+    const char* files[] = { "linux_eol.vdf", "binary.vdf" };
+
+    for (auto file : files)
+    {
+        std::ifstream f(file, std::ios::binary | std::ios::in);
+        std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        EasyVDF::ValveDataObject reference = EasyVDF::ValveDataObject::ParseObject(content.data(), content.length());
+
+        for (size_t block_size = 1; block_size < 10; ++block_size)
+        {
+            INFO(file << " with block size " << block_size);
+
+            ForwardOnlyBuffer buffer(content, block_size);
+            std::istream is(&buffer);
+            CHECK(EasyVDF::ValveDataObject::ParseObject(is, block_size).SerializeAsBinary() == reference.SerializeAsBinary());
+
+            ForwardOnlyBuffer reader_buffer(content, block_size);
+            std::istream reader_is(&reader_buffer);
+            EasyVDF::ParseOptions options;
+            options.chunk_size = block_size;
+            EasyVDF::ValveDataReader reader(reader_is, options);
+            CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::ObjectBegin);
+            CHECK(reader.Key() == EasyVDF::StringView(reference.Name()));
+        }
+    }
+
+    // VBKV header with its CRC checked
+    std::ifstream f("binary.vdf", std::ios::binary | std::ios::in);
+    std::string vbkv = EasyVDF::ValveDataObject::ParseObject(f).SerializeAsBinary(2);
+    ForwardOnlyBuffer vbkv_buffer(vbkv, 3);
+    std::istream vbkv_is(&vbkv_buffer);
+    EasyVDF::ParseOptions options;
+    options.verify_crc = true;
+    CHECK(EasyVDF::ValveDataObject::ParseObject(vbkv_is, options).SerializeAsBinary(2) == vbkv);
+
+    // Documents shorter than the format detection
+    std::string tiny = "a{}";
+    ForwardOnlyBuffer tiny_buffer(tiny, 1);
+    std::istream tiny_is(&tiny_buffer);
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(tiny_is);
+    CHECK(o.Name() == "a");
+    CHECK(o.Collection().empty());
+
+    // Same document from memory
+    EasyVDF::ValveDataObject from_buffer = EasyVDF::ValveDataObject::ParseObject(tiny.data(), tiny.length());
+    CHECK(from_buffer.Name() == "a");
+    CHECK(from_buffer.Collection().empty());
+    CHECK(EasyVDF::ValveDataCursor::Open(tiny.data(), tiny.length()).Name() == "a");
+    EasyVDF::ValveDataReader tiny_reader(tiny.data(), tiny.length(), EasyVDF::ParseOptions());
+    CHECK(tiny_reader.Next() == EasyVDF::ValveDataReader::Token::ObjectBegin);
+    CHECK(tiny_reader.Key() == "a");
+    CHECK(tiny_reader.Next() == EasyVDF::ValveDataReader::Token::ObjectEnd);
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(tiny.data(), 0), EasyVDF::ParserException);
+}
+
+TEST_CASE("Parse VDF as a view", "[parse_vdf_view]")
+{
+    std::string text = "\"Root\" { \"Name\" \"Value\" Escaped \"Multi\\tLine\" \"Child\" { \"Key\" \"1\" } \"Name\" \"Other\" }";
+
+    EasyVDF::ValveDataView view = EasyVDF::ValveDataView::Parse(text.data(), text.length());
+    EasyVDF::ValveDataViewNode root = view.Root();
+
+    CHECK(root.Type() == EasyVDF::ObjectType::Object);
+    CHECK(root.Name() == "Root");
+    CHECK(root.Size() == 4);
+
+    auto names = root["Name"];
+    REQUIRE(names.size() == 2);
+    CHECK(names[0].String() == "Value");
+    CHECK(names[1].String() == "Other");
+    // Unescaped strings reference the input
+    CHECK(names[0].String().data() == text.data() + text.find("Value"));
+    CHECK(root["Escaped"][0].String() == "Multi\tLine");
+    CHECK(root["Child"][0]["Key"][0].String() == "1");
+    CHECK_THROWS_AS(root["Child"][0].String(), std::invalid_argument);
+
+    // Same content as the owning parse, in the same order
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length());
+    size_t i = 0;
+    for (auto item : root)
+    {
+        REQUIRE(i < o.Collection().size());
+        CHECK(item.Name() == o.Collection()[i].Name());
+        CHECK(item.Type() == o.Collection()[i].Type());
+        ++i;
+    }
+    CHECK(i == o.Collection().size());
+
+    text = "\"Root\" { \"Key\" }";
+    CHECK_THROWS_AS(EasyVDF::ValveDataView::Parse(text.data(), text.length()), EasyVDF::ParserException);
+}
+
+TEST_CASE("Navigate VDF with a cursor", "[parse_vdf_cursor]")
+{
+    std::string text = "\"Root\"\n{\n\t\"Skipped\"\n\t{\n\t\t\"Braces\" \"{ } }\"\n\t\t\"Inner\" { \"Key\" \"\\\"}\" }\n\t}\n\t\"common\"\n\t{\n\t\t\"name\" \"Some\\tName\"\n\t}\n\t\"Version\" \"8\"\n}\n";
+
+    EasyVDF::ValveDataCursor root = EasyVDF::ValveDataCursor::Open(text.data(), text.length());
+    REQUIRE(root.Type() == EasyVDF::ObjectType::Object);
+    CHECK(root.Name() == "Root");
+
+    EasyVDF::ValveDataCursor name = root.Find("common").Find("name");
+    REQUIRE(name.Type() == EasyVDF::ObjectType::String);
+    CHECK(name.String() == "Some\tName");
+    CHECK(root.Find("Version").String() == "8");
+    CHECK(root.Find("Missing").Empty());
+    CHECK(root.Find("Skipped").Find("Inner").Find("Key").String() == "\"}");
+
+    std::vector<std::string> names;
+    for (auto const& item : root)
+        names.emplace_back(item.Name().str());
+
+    CHECK(names == std::vector<std::string>{ "Skipped", "common", "Version" });
+    CHECK(root["common"].size() == 1);
+    CHECK_THROWS_AS(root.Find("Version").Find("x"), std::invalid_argument);
+
+    // Materialized subtrees are the same as the owning parse
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length());
+    CHECK(root.ToObject().SerializeAsBinary() == o.SerializeAsBinary());
+    CHECK(root.Find("Skipped").ToObject().SerializeAsBinary() == o["Skipped"][0].SerializeAsBinary());
+
+    // Errors are only found when navigated to, with their line in the document
+    text = "\"Root\"\n{\n\t\"Key\" \"Value\"\n\t\"Bad\" { \"Item\" }\n}\n";
+    root = EasyVDF::ValveDataCursor::Open(text.data(), text.length());
+    CHECK(root.Find("Key").String() == "Value");
+    CHECK_THROWS_WITH(root.Find("Bad").Find("Item"), "Expected item value start at line 4");
+}
+
+struct CountingHandler
+{
+    int depth = 0;
+    int max_depth = 0;
+    int objects = 0;
+    int values = 0;
+    int32_t int32 = 0;
+    std::string path;
+
+    void OnObjectBegin(EasyVDF::StringView key)
+    {
+        ++objects;
+        if (++depth > max_depth)
+            max_depth = depth;
+
+        path += "/" + key.str();
+    }
+
+    void OnObjectEnd()
+    {
+        --depth;
+        path.erase(path.rfind('/'));
+    }
+
+    void OnValue(EasyVDF::StringView key, EasyVDF::ValveDataValue const& value)
+    {
+        ++values;
+        if (value.Type() == EasyVDF::ObjectType::Int32)
+            int32 = value.Int32();
+        if (key == "ObjectEntry")
+            CHECK(path + "=" + value.String().str() == "/999999/ObjectKey=ObjectEntryValue");
+    }
+};
+
+TEST_CASE("Parse VDF with a handler", "[parse_vdf_handler]")
+{
+    {
+        std::ifstream f("linux_eol.vdf", std::ios::binary | std::ios::in);
+        CountingHandler handler;
+        EasyVDF::ParseWithHandler(f, handler);
+
+        CHECK(handler.depth == 0);
+        CHECK(handler.max_depth == 2);
+        CHECK(handler.objects == 2);
+        CHECK(handler.values == 2);
+    }
+    {
+        std::ifstream f("binary.vdf", std::ios::binary | std::ios::in);
+        std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        CountingHandler handler;
+        EasyVDF::ParseWithHandler(data.data(), data.length(), handler);
+
+        CHECK(handler.depth == 0);
+        CHECK(handler.int32 == -1337);
+
+        // The view is built by the same parser
+        EasyVDF::ValveDataView view = EasyVDF::ValveDataView::Parse(data.data(), data.length());
+        CHECK(view.Root().Name() == "RootObject");
+        CHECK(view.Root()["StringKey"][0].String() == "StringValue");
+        CHECK(view.Root()["Int64Key"][0].Int64() == -99999999999991337);
+        CHECK(view.Root()["ColorKey"][0].Color().value == 0x99887766);
+    }
+}
+
+struct RecordingHandler
+{
+    std::vector<std::string> events;
+
+    void OnObjectBegin(EasyVDF::StringView key)
+    {
+        events.emplace_back("begin " + key.str());
+    }
+
+    void OnObjectEnd()
+    {
+        events.emplace_back("end");
+    }
+
+    void OnValue(EasyVDF::StringView key, EasyVDF::ValveDataValue const& value)
+    {
+        events.emplace_back("value " + key.str() + " " + std::to_string((int)value.Type()));
+    }
+};
+
+static std::vector<std::string> read_events(EasyVDF::ValveDataReader& reader)
+{
+    std::vector<std::string> events;
+    EasyVDF::ValveDataReader::Token token;
+    while ((token = reader.Next()) != EasyVDF::ValveDataReader::Token::End)
+    {
+        switch (token)
+        {
+            case EasyVDF::ValveDataReader::Token::ObjectBegin: events.emplace_back("begin " + reader.Key().str()); break;
+            case EasyVDF::ValveDataReader::Token::ObjectEnd  : events.emplace_back("end"); break;
+            default: events.emplace_back("value " + reader.Key().str() + " " + std::to_string((int)reader.Value().Type())); break;
+        }
+    }
+    return events;
+}
+
+TEST_CASE("Read VDF with a pull reader", "[parse_vdf_reader]")
+{
+    const char* files[] = { "linux_eol.vdf", "macos_eol.vdf", "windows_eol.vdf", "binary.vdf" };
+
+    for (auto file : files)
+    {
+        std::ifstream f(file, std::ios::binary | std::ios::in);
+        std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+        RecordingHandler handler;
+        EasyVDF::ParseWithHandler(data.data(), data.length(), handler);
+
+        INFO(file);
+        EasyVDF::ValveDataReader reader(data.data(), data.length());
+        CHECK(read_events(reader) == handler.events);
+        CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::End);
+
+        for (size_t chunk_size = 1; chunk_size < 20; ++chunk_size)
+        {
+            std::stringstream ss(data);
+            EasyVDF::ParseOptions options;
+            options.chunk_size = chunk_size;
+            EasyVDF::ValveDataReader stream_reader(ss, options);
+            CHECK(read_events(stream_reader) == handler.events);
+        }
+    }
+
+    std::string text = "\"Root\" { \"Skipped\" { \"A\" { \"B\" \"}\" } } \"Key\" \"Value\" \"Truncated\" { \"C\" \"D\"";
+    EasyVDF::ValveDataReader reader(text.data(), text.length());
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::ObjectBegin);
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::ObjectBegin);
+    CHECK(reader.Key() == "Skipped");
+    reader.SkipObject();
+    CHECK(reader.Depth() == 1);
+    REQUIRE(reader.Next() == EasyVDF::ValveDataReader::Token::Value);
+    CHECK(reader.Key() == "Key");
+    CHECK(reader.Value().String() == "Value");
+    // The opened objects are closed at the end of the input
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::ObjectBegin);
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::Value);
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::ObjectEnd);
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::ObjectEnd);
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::End);
+}
+
+TEST_CASE("Parse VDF on several threads", "[parse_vdf_threads]")
+{
+    // Big enough to be cut in several chunks, with braces and escaped quotes in strings
+    std::string text = "\"Root\"\n{\n";
+    for (int i = 0; i < 40000; ++i)
+    {
+        text += "\t\"" + std::to_string(i) + "\"\n\t{\n\t\t\"name\"\t\"App {" + std::to_string(i) + "} \\\"quoted\\\"\"\n";
+        text += "\t\t\"depots\" { \"1\" { \"size\" \"1024\" } \"2\" \"}\" }\n\t\t\"path\"\tC:\\\\Games\n\t}\n";
+    }
+    text += "}\n";
+
+    EasyVDF::ValveDataObject reference = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length());
+
+    EasyVDF::ParseOptions options;
+    for (uint32_t threads : { 2u, 3u, 8u })
+    {
+        options.threads = threads;
+        EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+
+        INFO(threads << " threads");
+        CHECK(o.SerializeAsBinary() == reference.SerializeAsBinary());
+    }
+
+    // Binary, split at the root items or at their children
+    std::string binary = reference.SerializeAsBinary();
+    for (uint32_t split_depth : { 1u, 2u })
+    {
+        options.threads = 4;
+        options.binary_split_depth = split_depth;
+        EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length(), options);
+
+        INFO("split depth " << split_depth);
+        CHECK(o.SerializeAsBinary() == binary);
+    }
+    options.binary_split_depth = 1;
+
+    // Errors are the same as without threads
+    text.insert(text.find("\n\t}\n", text.length() / 2) + 1, "\"Key\" }");
+    options.threads = 4;
+    std::string error, threaded_error;
+    try { EasyVDF::ValveDataObject::ParseObject(text.data(), text.length()); } catch (EasyVDF::ParserException& e) { error = e.what(); }
+    try { EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options); } catch (EasyVDF::ParserException& e) { threaded_error = e.what(); }
+    CHECK(!error.empty());
+    CHECK(threaded_error == error);
+}
+
+TEST_CASE("Parse VDF pushed by chunks", "[parse_vdf_push]")
+{
+    const char* files[] = { "linux_eol.vdf", "macos_eol.vdf", "windows_eol.vdf", "binary.vdf" };
+
+    for (auto file : files)
+    {
+        std::ifstream f(file, std::ios::binary | std::ios::in);
+        std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+        RecordingHandler reference;
+        EasyVDF::ParseWithHandler(data.data(), data.length(), reference);
+
+        INFO(file);
+        for (size_t chunk_size = 1; chunk_size < 80; chunk_size += 3)
+        {
+            RecordingHandler handler;
+            EasyVDF::ValveDataPushParser<RecordingHandler> parser(handler);
+            for (size_t i = 0; i < data.length(); i += chunk_size)
+            {
+                // Each chunk is released after the call
+                std::string chunk = data.substr(i, chunk_size);
+                parser.Feed(chunk.data(), chunk.length());
+            }
+            parser.Finish();
+
+            INFO(chunk_size << " bytes chunks");
+            CHECK(parser.Done());
+            CHECK(handler.events == reference.events);
+        }
+
+        EasyVDF::ValveDataObject o;
+        EasyVDF::ValveDataObjectBuilder builder(o);
+        EasyVDF::ValveDataPushParser<EasyVDF::ValveDataObjectBuilder> parser(builder);
+        parser.Feed(data.data(), data.length() / 2);
+        parser.Feed(data.data() + data.length() / 2, data.length() - data.length() / 2);
+        parser.Finish();
+        CHECK(o.SerializeAsBinary() == EasyVDF::ValveDataObject::ParseObject(data.data(), data.length()).SerializeAsBinary());
+    }
+
+    // The root object ends before the input, the rest is ignored
+    std::string text = "\"Root\" { \"Key\" \"Value\" } garbage";
+    RecordingHandler handler;
+    EasyVDF::ValveDataPushParser<RecordingHandler> parser(handler);
+    parser.Feed(text.data(), text.length());
+    parser.Finish();
+    CHECK(parser.Done());
+    CHECK(handler.events.size() == 3);
+
+    // Whole document shorter than the binary magic
+    RecordingHandler tiny_handler;
+    EasyVDF::ValveDataPushParser<RecordingHandler> tiny_parser(tiny_handler);
+    tiny_parser.Feed("a{}", 3);
+    tiny_parser.Finish();
+    CHECK(tiny_parser.Done());
+    CHECK(tiny_handler.events == std::vector<std::string>{ "begin a", "end" });
+
+    // Errors give the line they were found at
+    text = "\"Root\"\n{\n\t\"Key\"\n\t\"Value\"\n\t\"Sub\" } {";
+    std::string error;
+    RecordingHandler error_handler;
+    EasyVDF::ValveDataPushParser<RecordingHandler> bad_parser(error_handler);
+    try
+    {
+        for (char c : text)
+            bad_parser.Feed(&c, 1);
+
+        bad_parser.Finish();
+    }
+    catch (EasyVDF::ParserException& e)
+    {
+        error = e.what();
+    }
+    CHECK(error == "Expected item value start at line 5");
+}
+
+TEST_CASE("Validate UTF-8", "[parse_vdf_utf8]")
+{
+    EasyVDF::ParseOptions options;
+    options.validate_utf8 = true;
+
+    // Long enough for the sequences to cross the SIMD blocks
+    std::string text = "\"Root\"\n{\n";
+    for (int i = 0; i < 200; ++i)
+        text += "\t\"Key" + std::to_string(i) + "\"\t\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"\n";
+    text += "}\n";
+
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+    CHECK(o.Collection().size() == 200);
+
+    std::string binary = o.SerializeAsBinary();
+    CHECK_NOTHROW(EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length(), options));
+
+    const char* invalid[] = { "\xc3\x28", "\xe0\x80\x80", "\xed\xa0\x80", "\xf4\x90\x80\x80", "\xff", "\xc3" };
+    for (auto sequence : invalid)
+    {
+        INFO(sequence);
+        std::string bad_text = text;
+        bad_text.insert(bad_text.find("Key150") + 3, sequence);
+        // Without validation, the bytes are kept as is
+        CHECK_NOTHROW(EasyVDF::ValveDataObject::ParseObject(bad_text.data(), bad_text.length()));
+
+        std::string error;
+        try { EasyVDF::ValveDataObject::ParseObject(bad_text.data(), bad_text.length(), options); } catch (EasyVDF::ParserException& e) { error = e.what(); }
+        CHECK(error == "Invalid UTF-8 at line 153");
+
+        std::stringstream ss(bad_text);
+        CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(ss, options), EasyVDF::ParserException);
+
+        std::string bad_binary = binary;
+        bad_binary.insert(bad_binary.find("Key150") + 3, sequence);
+        CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(bad_binary.data(), bad_binary.length(), options), EasyVDF::ParserException);
+    }
+
+    // Unfinished sequence at the end of the input, with and without a partial block
+    text = "\"Root\" { \"Key\" \"Value";
+    text.resize(126, 'x');
+    text += "\xe2\x82";
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options), EasyVDF::ParserException);
+    text.pop_back();
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options), EasyVDF::ParserException);
+}
+
+struct MemoryResolver : public EasyVDF::ValveDataResolver
+{
+    std::map<std::string, std::pair<std::string, int64_t>> files;
+    int reads = 0;
+
+    std::string Resolve(std::string const& from, std::string const& name) override
+    {
+        return from.empty() ? name : from.substr(0, from.find_last_of('/') + 1) + name;
+    }
+
+    bool Stat(std::string const& path, int64_t& mtime) override
+    {
+        auto it = files.find(path);
+        if (it == files.end())
+            return false;
+
+        mtime = it->second.second;
+        return true;
+    }
+
+    bool Read(std::string const& path, std::string& content) override
+    {
+        ++reads;
+        content = files.at(path).first;
+        return true;
+    }
+};
+
+TEST_CASE("Resolve #base and #include", "[parse_vdf_directives]")
+{
+    MemoryResolver resolver;
+    resolver.files["scripts/base.res"] = { "#include \"shared.res\"\n\"Base\" { \"Color\" \"red\" \"Size\" \"10\" \"Panel\" { \"Wide\" \"100\" \"Tall\" \"50\" } }", 1 };
+    resolver.files["scripts/shared.res"] = { "\"Shared\" { \"Font\" \"Arial\" }", 1 };
+
+    std::string text = "#base \"scripts/base.res\"\n\"Root\"\n{\n\t\"Size\" \"20\"\n\t\"Panel\" { \"Wide\" \"200\" }\n}\n";
+
+    EasyVDF::ParseOptions options;
+    options.resolver = &resolver;
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+
+    // The document keys win over the base ones
+    CHECK(o.Name() == "Root");
+    CHECK(o["Size"][0].String() == "20");
+    CHECK(o["Color"][0].String() == "red");
+    CHECK(o["Panel"][0]["Wide"][0].String() == "200");
+    CHECK(o["Panel"][0]["Tall"][0].String() == "50");
+    // Included by the base, relative to it
+    CHECK(o["Font"][0].String() == "Arial");
+
+    std::stringstream ss(text);
+    CHECK(EasyVDF::ValveDataObject::ParseObject(ss, options).SerializeAsText() == o.SerializeAsText());
+
+    // Without resolver, directives are not recognized
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length()), EasyVDF::ParserException);
+
+    // With a cache, each fragment is only parsed once
+    EasyVDF::ValveDataIncludeCache cache;
+    options.include_cache = &cache;
+    resolver.reads = 0;
+    for (int i = 0; i < 10; ++i)
+        CHECK(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options).SerializeAsText() == o.SerializeAsText());
+
+    CHECK(resolver.reads == 2);
+    CHECK(cache.Size() == 2);
+
+    // Modified files are parsed again, with the files that include them
+    resolver.files["scripts/shared.res"] = { "\"Shared\" { \"Font\" \"Verdana\" }", 2 };
+    CHECK(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options)["Font"][0].String() == "Verdana");
+    CHECK(resolver.reads == 4);
+
+    resolver.files["scripts/base.res"] = { "\"Base\" { \"Color\" \"blue\" }", 2 };
+    EasyVDF::ValveDataObject modified = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+    CHECK(modified["Color"][0].String() == "blue");
+    CHECK(modified["Font"].size() == 0);
+    CHECK(resolver.reads == 5);
+
+    // The options that change the fragments are part of the key
+    resolver.files["escaped.res"] = { "\"Escaped\" { \"Key\" \"a\\tb\" }", 1 };
+    text = "#base \"escaped.res\" \"Root\" {}";
+    CHECK(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options)["Key"][0].String() == "a\tb");
+    options.escape_sequences = false;
+    CHECK(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options)["Key"][0].String() == "a\\tb");
+    options.escape_sequences = true;
+    CHECK(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options)["Key"][0].String() == "a\tb");
+    CHECK(resolver.reads == 7);
+
+    resolver.files["a.res"] = { "#include \"b.res\" \"A\" {}", 1 };
+    resolver.files["b.res"] = { "#include \"a.res\" \"B\" {}", 1 };
+    text = "#include \"a.res\" \"Root\" {}";
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options), EasyVDF::ParserException);
+
+    text = "#base \"missing.res\" \"Root\" {}";
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options), EasyVDF::ParserException);
+
+    // A document of directives only takes the name of the fragment
+    resolver.files["root.res"] = { "\"root\" { \"Key\" \"Value\" }", 1 };
+    text = "#base \"root.res\"";
+    EasyVDF::ValveDataObject directives_only = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+    CHECK(directives_only.Name() == "root");
+    CHECK(directives_only.Collection().size() == 1);
+    CHECK(directives_only["Key"][0].String() == "Value");
+}
+
+TEST_CASE("Evaluate [$CONDITION] blocks", "[parse_vdf_conditions]")
+{
+    std::string text =
+        "\"Root\"\n"
+        "{\n"
+        "\t\"Path\"\t\"C:\\\\Games\"\t[$WIN32]\n"
+        "\t\"Path\"\t\"/home/games\"\t[$LINUX]\n"
+        "\t\"Console\"\t[$X360]\n"
+        "\t{\n"
+        "\t\t\"Skipped\" { \"Brace\" \"}\" }\n"
+        "\t}\n"
+        "\t\"Desktop\"\t[!$X360]\n"
+        "\t{\n"
+        "\t\t\"Font\"\t\"Tahoma\"\t[$WIN32||$OSX]\n"
+        "\t\t\"Size\"\t[$WIN32&&!$LINUX]\t\"12\"\n"
+        "\t}\n"
+        "\t\"Last\"\t\"Value\"\n"
+        "}\n";
+
+    std::vector<std::string> defines = { "win32" };
+    EasyVDF::ParseOptions options;
+    options.defines = &defines;
+
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+    REQUIRE(o["Path"].size() == 1);
+    CHECK(o["Path"][0].String() == "C:\\Games");
+    CHECK(o["Console"].size() == 0);
+    CHECK(o["Desktop"][0]["Font"][0].String() == "Tahoma");
+    CHECK(o["Desktop"][0]["Size"][0].String() == "12");
+    CHECK(o["Last"][0].String() == "Value");
+
+    for (size_t chunk_size = 1; chunk_size < 40; chunk_size += 7)
+    {
+        std::stringstream ss(text);
+        options.chunk_size = chunk_size;
+        CHECK(EasyVDF::ValveDataObject::ParseObject(ss, options).SerializeAsText() == o.SerializeAsText());
+    }
+
+    CountingHandler handler;
+    EasyVDF::ParseWithHandler(text.data(), text.length(), handler, options);
+    CHECK(handler.objects == 2);
+    CHECK(handler.values == 4);
+
+    auto view = EasyVDF::ValveDataView::Parse(text.data(), text.length(), options);
+    CHECK(view.Root()["Console"].empty());
+
+    defines = { "LINUX", "X360" };
+    o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+    CHECK(o["Path"][0].String() == "/home/games");
+    CHECK(o["Console"][0]["Skipped"][0]["Brace"][0].String() == "}");
+    CHECK(o["Desktop"].size() == 0);
+
+    // Without defines, conditions are regular tokens
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length()), EasyVDF::ParserException);
+
+    text = "\"Root\" { \"Key\" \"Value\" [WIN32] }";
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options), EasyVDF::ParserException);
+    text = "\"Root\" { \"Key\" \"Value\" [$WIN32|$OSX] }";
+    CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options), EasyVDF::ParserException);
+}
+
+TEST_CASE("Infer the type of text values", "[parse_vdf_infer_types]")
+{
+    std::string text =
+        "\"Root\"\n"
+        "{\n"
+        "\t\"Int32\"\t\"-2147483648\"\n"
+        "\t\"Int64\"\t\"76561197960265728\"\n"
+        "\t\"UInt64\"\t\"18446744073709551615\"\n"
+        "\t\"Float\"\t\"-0.015625\"\n"
+        "\t\"Unquoted\"\t1234\n"
+        // Not written back the same way
+        "\t\"Zeros\"\t\"007\"\n"
+        "\t\"Precise\"\t\"3.14159265\"\n"
+        "\t\"Trailing\"\t\"1.50\"\n"
+        "\t\"Exponent\"\t\"1e5\"\n"
+        "\t\"Overflow\"\t\"18446744073709551616\"\n"
+        "\t\"Text\"\t\"12 monkeys\"\n"
+        "}\n";
+
+    EasyVDF::ParseOptions options;
+    options.infer_types = true;
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options);
+
+    CHECK(o["Int32"][0].Int32() == INT32_MIN);
+    CHECK(o["Int64"][0].Int64() == 76561197960265728ll);
+    CHECK(o["UInt64"][0].UInt64() == UINT64_MAX);
+    CHECK(o["Float"][0].Float() == -0.015625f);
+    CHECK(o["Unquoted"][0].Int32() == 1234);
+    for (auto key : { "Zeros", "Precise", "Trailing", "Exponent", "Overflow", "Text" })
+    {
+        INFO(key);
+        CHECK(o[key][0].Type() == EasyVDF::ObjectType::String);
+    }
+
+    // Lossless
+    CHECK(o.SerializeAsText() == EasyVDF::ValveDataObject::ParseObject(text.data(), text.length()).SerializeAsText());
+
+    std::stringstream ss(text);
+    CHECK(EasyVDF::ValveDataObject::ParseObject(ss, options).SerializeAsBinary() == o.SerializeAsBinary());
+
+    EasyVDF::ValveDataReader reader(text.data(), text.length(), options);
+    reader.Next();
+    CHECK(reader.Next() == EasyVDF::ValveDataReader::Token::Value);
+    CHECK(reader.Value().Int32() == INT32_MIN);
+}
+
+TEST_CASE("Lint VDF", "[parse_vdf_lint]")
+{
+    using Kind = EasyVDF::ParseDiagnostic::Kind;
+    std::string text =
+        "\"Root\"\n"
+        "{\n"
+        "\t\"A\"\t\"1\"\n"
+        "\t{ \"Lost\" \"x\" }\n"
+        "\t\"Cond\"\t\"v\"\t[BAD]\n"
+        "\t\"Sub\"\n"
+        "\t{\n"
+        "\t\t\"B\"\n"
+        "\t}\n"
+        "\t\"C\"\t\"3\"\n"
+        "\t\"Open\"\n"
+        "\t{\n"
+        "\t\t\"D\"\t\"4\"\n";
+
+    std::vector<std::string> defines = { "WIN32" };
+    EasyVDF::ParseOptions options;
+    options.defines = &defines;
+
+    std::vector<EasyVDF::ParseDiagnostic> diagnostics;
+    EasyVDF::ValveDataObject o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), diagnostics, options);
+    REQUIRE(diagnostics.size() == 4);
+    CHECK(diagnostics[0].kind == Kind::ExpectedKey);
+    CHECK(diagnostics[0].line == 4);
+    CHECK(diagnostics[0].column == 2);
+    CHECK(text.compare(diagnostics[0].offset, 2, "{ ") == 0);
+    CHECK(diagnostics[1].kind == Kind::InvalidCondition);
+    CHECK(diagnostics[1].line == 5);
+    CHECK(diagnostics[1].column == 13);
+    CHECK(diagnostics[2].kind == Kind::ExpectedValue);
+    CHECK(diagnostics[2].line == 9);
+    CHECK(diagnostics[2].column == 2);
+    CHECK(diagnostics[3].kind == Kind::UnclosedObject);
+    CHECK(diagnostics[3].line == 14);
+    CHECK(diagnostics[3].offset == text.length());
+
+    // Partial tree
+    CHECK(o.Name() == "Root");
+    CHECK(o["A"][0].String() == "1");
+    CHECK(o["Cond"][0].String() == "v");
+    CHECK(o["Sub"][0].Collection().empty());
+    CHECK(o["C"][0].String() == "3");
+    CHECK(o["Open"][0]["D"][0].String() == "4");
+
+    CHECK_THROWS_WITH(EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), options), "Expected item key start at line 4");
+
+    // Valid input, same tree as the parse that throws
+    std::string valid = "\"Root\" { \"A\" \"1\" \"Sub\" { \"B\" \"2\" } }";
+    diagnostics.clear();
+    o = EasyVDF::ValveDataObject::ParseObject(valid.data(), valid.length(), diagnostics);
+    CHECK(diagnostics.empty());
+    CHECK(o.SerializeAsText() == EasyVDF::ValveDataObject::ParseObject(valid.data(), valid.length()).SerializeAsText());
+
+    // Too deep objects are skipped, data after the root is reported
+    options = EasyVDF::ParseOptions();
+    options.max_depth = 2;
+    options.validate_utf8 = true;
+    text = "\"Root\" { \"Deep\" { \"Deeper\" { } } \"K\" \"\xC3\x28\" } \"Extra\" { }";
+    diagnostics.clear();
+    o = EasyVDF::ValveDataObject::ParseObject(text.data(), text.length(), diagnostics, options);
+    REQUIRE(diagnostics.size() == 3);
+    CHECK(diagnostics[0].kind == Kind::MaxDepthExceeded);
+    CHECK(diagnostics[0].column == 28);
+    CHECK(diagnostics[1].kind == Kind::InvalidUtf8);
+    CHECK(diagnostics[1].offset == text.find('\xC3'));
+    CHECK(diagnostics[2].kind == Kind::TrailingData);
+    CHECK(text.compare(diagnostics[2].offset, 7, "\"Extra\"") == 0);
+    CHECK(o["Deep"][0].Collection().empty());
+    CHECK(o["K"].size() == 1);
+
+    diagnostics.clear();
+    EasyVDF::ValveDataObject::ParseObject("", 0, diagnostics);
+    REQUIRE(diagnostics.size() == 1);
+    CHECK(diagnostics[0].kind == Kind::InvalidInput);
+
+    // Shorter than the binary magic, checked as text
+    diagnostics.clear();
+    EasyVDF::ValveDataObject::ParseObject("ab", 2, diagnostics);
+    REQUIRE(diagnostics.size() == 1);
+    CHECK(diagnostics[0].kind == Kind::ExpectedObjectStart);
+
+    // Unknown binary item type
+    diagnostics.clear();
+    EasyVDF::ValveDataObject unknown_type = EasyVDF::ValveDataObject::ParseObject("\0root\0\x0ekey\0\x08\x08", 13, diagnostics);
+    REQUIRE(diagnostics.size() == 1);
+    CHECK(diagnostics[0].kind == Kind::InvalidInput);
+    CHECK(diagnostics[0].message == "Unhandled binary item type 14");
+    CHECK(unknown_type.Name() == "root");
+}
+
+template<typename T>
+static void append_field(std::string& out, T value)
+{
+    out.append((const char*)&value, sizeof(value));
+}
+
+static std::string app_blob(int32_t appid, std::string const& name)
+{
+    EasyVDF::ValveDataObject common("common");
+    common.Collection().emplace_back("name", name);
+
+    EasyVDF::ValveDataObject appinfo("appinfo");
+    appinfo.Collection().emplace_back("appid", appid);
+    appinfo.Collection().emplace_back(std::move(common));
+    return appinfo.SerializeAsBinary();
+}
+
+static std::string from_hex(const char* hex)
+{
+    std::string bytes;
+    for (; hex[0] != '\0' && hex[1] != '\0'; hex += 2)
+        bytes += (char)std::stoi(std::string(hex, 2), nullptr, 16);
+
+    return bytes;
+}
+
+// Appends an appinfo entry, binary_sha1 is empty for v27.
+static void append_app(std::string& out, uint32_t appid, std::string const& blob, std::string const& binary_sha1)
+{
+    append_field(out, appid);
+    append_field(out, (uint32_t)(blob.length() + 40 + binary_sha1.length()));
+    append_field(out, (uint32_t)2);          // info state
+    append_field(out, (uint32_t)1700000000); // last updated
+    append_field(out, (uint64_t)appid * 3);  // pics token
+    out.append(20, '\x11');
+    append_field(out, (uint32_t)appid + 100); // change number
+    out += binary_sha1;
+    out += blob;
+}
+
+TEST_CASE("Read appinfo and packageinfo containers", "[parse_container]")
+{
+    // appinfo v28
+    std::string appinfo;
+    append_field(appinfo, (uint32_t)0x07564428);
+    append_field(appinfo, (uint32_t)1);
+    append_app(appinfo, 730, app_blob(730, "Counter-Strike 2"), from_hex("628360baf933bd0f96312848d951bacb55f20ed2"));
+    append_app(appinfo, 10, app_blob(10, "Counter-Strike"), from_hex("7d5eea9392e32f4cc7aaf8855833d2c7d0969134"));
+    append_app(appinfo, 440, app_blob(440, "Team Fortress 2"), from_hex("c212b60fb0cb142714cdfe3440a15072de62bb99"));
+    append_field(appinfo, (uint32_t)0);
+
+    auto container = EasyVDF::ValveDataContainer::Open(appinfo.data(), appinfo.length());
+    CHECK(container.ContainerFormat() == EasyVDF::ValveDataContainer::Format::AppInfo);
+    CHECK(container.Version() == 28);
+    CHECK(container.Universe() == 1);
+    REQUIRE(container.Entries().size() == 3);
+    CHECK(container.Entries()[1].id == 10);
+    CHECK(container.Entries()[1].change_number == 110);
+    CHECK(container.Entries()[1].pics_token == 30);
+    CHECK(container.Entries()[1].binary_sha1[0] == 0x7d);
+
+    auto entry = container.Find(440);
+    REQUIRE(entry != nullptr);
+    CHECK(entry->info_state == 2);
+    CHECK(container.Parse(*entry)["common"][0]["name"][0].String() == "Team Fortress 2");
+    CHECK(container.Parse(730)["appid"][0].Int32() == 730);
+    CHECK(container.Find(570) == nullptr);
+    CHECK_THROWS_AS(container.Parse(570), EasyVDF::ParserException);
+
+    CHECK_THROWS_AS(EasyVDF::ValveDataContainer::Open(appinfo.data(), appinfo.length() - 10), EasyVDF::ParserException);
+
+    // Whole container on several threads, with the checksums
+    EasyVDF::ParseOptions options;
+    options.threads = 4;
+    auto apps = container.ParseAll(options);
+    REQUIRE(apps.size() == 3);
+    CHECK(apps.begin()->first == 10);
+    CHECK(apps[730].Name() == container.Parse(730).Name());
+    CHECK(apps[730].Name() == "appinfo");
+    CHECK(apps[730]["common"][0]["name"][0].String() == "Counter-Strike 2");
+
+    appinfo[appinfo.find("Team Fortress")] = 't';
+    container = EasyVDF::ValveDataContainer::Open(appinfo.data(), appinfo.length());
+    CHECK(container.Verify(*container.Find(730)));
+    CHECK(!container.Verify(*container.Find(440)));
+    CHECK_THROWS_WITH(container.ParseAll(options), "SHA-1 mismatch of container entry 440");
+    CHECK(container.ParseAll(options, false)[440]["common"][0]["name"][0].String() == "team Fortress 2");
+
+    // appinfo v29, the keys are indexes into the string table that follows the entries
+    std::string blob;
+    blob += '\x00'; append_field(blob, (uint32_t)0);                                 // appinfo
+    blob += '\x02'; append_field(blob, (uint32_t)1); append_field(blob, (int32_t)570); // appid
+    blob += '\x00'; append_field(blob, (uint32_t)2);                                 // common
+    blob += '\x01'; append_field(blob, (uint32_t)3); blob.append("Dota 2", 7);         // name
+    blob += "\x08\x08";
+
+    appinfo.clear();
+    append_field(appinfo, (uint32_t)0x07564429);
+    append_field(appinfo, (uint32_t)1);
+    append_field(appinfo, (int64_t)0);
+    append_app(appinfo, 570, blob, std::string(20, '\0'));
+    append_field(appinfo, (uint32_t)0);
+    int64_t table_offset = (int64_t)appinfo.length();
+    memcpy(&appinfo[8], &table_offset, sizeof(table_offset));
+    append_field(appinfo, (uint32_t)4);
+    appinfo.append("appinfo\0appid\0common\0name\0", 26);
+
+    container = EasyVDF::ValveDataContainer::Open(appinfo.data(), appinfo.length());
+    CHECK(container.Version() == 29);
+    EasyVDF::ValveDataObject dota = container.Parse(570);
+    CHECK(dota.Name() == "appinfo");
+    CHECK(dota["appid"][0].Int32() == 570);
+    CHECK(dota["common"][0]["name"][0].String() == "Dota 2");
+
+    // packageinfo v28, the entries have no size
+    std::string packageinfo;
+    append_field(packageinfo, (uint32_t)0x06565528);
+    append_field(packageinfo, (uint32_t)1);
+    for (uint32_t id : { 0u, 42u })
+    {
+        EasyVDF::ValveDataObject package(std::to_string(id));
+        package.Collection().emplace_back("packageid", (int32_t)id);
+        package.Collection().emplace_back(EasyVDF::ValveDataObject("appids"));
+
+        append_field(packageinfo, id);
+        packageinfo.append(20, '\x33');
+        append_field(packageinfo, (uint32_t)7); // change number
+        append_field(packageinfo, (uint64_t)9); // pics token
+        packageinfo += package.SerializeAsBinary();
+    }
+    append_field(packageinfo, (uint32_t)0xffffffff);
+
+    container = EasyVDF::ValveDataContainer::Open(packageinfo.data(), packageinfo.length());
+    CHECK(container.ContainerFormat() == EasyVDF::ValveDataContainer::Format::PackageInfo);
+    REQUIRE(container.Entries().size() == 2);
+    CHECK(container.Entries()[1].pics_token == 9);
+    CHECK(container.Parse(0)["packageid"][0].Int32() == 0);
+    CHECK(container.Parse(42).Name() == "42");
 }
 
 TEST_CASE("Serialize to text", "[serialize_object_as_text]")
@@ -181,7 +1339,45 @@ TEST_CASE("Serialize to binary", "[binary_serialize]")
     SECTION("Serializing to binary V2")
     {
         o.SerializeAsBinary(sstr, 2);
-        CHECK(memcmp(sstr.str().data(), "\x56\x42\x4b\x56\x00\x00\x00\x00\x00\x39", 10) == 0);
+        CHECK(memcmp(sstr.str().data(), "\x56\x42\x4b\x56\x47\x97\xb0\x43\x00\x39", 10) == 0);
+    }
+
+    sstr.str(std::string());
+    SECTION("Verifying the CRC of binary V2")
+    {
+        CHECK(EasyVDF::Details::Crc32(0, "123456789", 9) == 0xcbf43926);
+
+        o.SerializeAsBinary(sstr, 2);
+        std::string binary = sstr.str();
+
+        EasyVDF::ParseOptions options;
+        options.verify_crc = true;
+        CHECK(EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length(), options).SerializeAsText() == o.SerializeAsText());
+
+        std::stringstream stream(binary);
+        CHECK(EasyVDF::ValveDataObject::ParseObject(stream, options).SerializeAsText() == o.SerializeAsText());
+
+        EasyVDF::ValveDataObject pushed;
+        EasyVDF::ValveDataObjectBuilder builder(pushed);
+        EasyVDF::ValveDataPushParser<EasyVDF::ValveDataObjectBuilder> parser(builder, options);
+        parser.Feed(binary.data(), binary.length() / 3);
+        parser.Feed(binary.data() + binary.length() / 3, binary.length() - binary.length() / 3);
+        parser.Finish();
+        CHECK(pushed.SerializeAsText() == o.SerializeAsText());
+
+        binary[binary.length() / 2] ^= 1;
+        CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length(), options), EasyVDF::ParserException);
+
+        stream.str(binary);
+        CHECK_THROWS_AS(EasyVDF::ValveDataObject::ParseObject(stream, options), EasyVDF::ParserException);
+
+        EasyVDF::ValveDataObject corrupted;
+        EasyVDF::ValveDataObjectBuilder corrupted_builder(corrupted);
+        EasyVDF::ValveDataPushParser<EasyVDF::ValveDataObjectBuilder> corrupted_parser(corrupted_builder, options);
+        CHECK_THROWS_AS(corrupted_parser.Feed(binary.data(), binary.length()), EasyVDF::ParserException);
+
+        // Not checked by default.
+        CHECK_NOTHROW(EasyVDF::ValveDataObject::ParseObject(binary.data(), binary.length()));
     }
 }
 